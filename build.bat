@@ -19,7 +19,7 @@ if %errorlevel% neq 0 (
 
 REM 设置编译选项
 set CC=gcc
-set CFLAGS=-Wall -Wextra -std=c11 -g -D_POSIX_C_SOURCE=200809L
+set CFLAGS=-Wall -Wextra -std=c11 -g -D_POSIX_C_SOURCE=200809L -pthread
 set INCLUDES=-I./include
 set SRCDIR=src
 set OBJDIR=obj
@@ -40,9 +40,36 @@ if %errorlevel% neq 0 goto :error
 %CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\process.c -o %OBJDIR%\process.o
 if %errorlevel% neq 0 goto :error
 
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\exec_cache.c -o %OBJDIR%\exec_cache.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\zygote.c -o %OBJDIR%\zygote.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\output_ring.c -o %OBJDIR%\output_ring.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\cgroup.c -o %OBJDIR%\cgroup.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\pipeline.c -o %OBJDIR%\pipeline.o
+if %errorlevel% neq 0 goto :error
+
 %CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\file_system.c -o %OBJDIR%\file_system.o
 if %errorlevel% neq 0 goto :error
 
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\file_data.c -o %OBJDIR%\file_data.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\compress.c -o %OBJDIR%\compress.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\disk_image.c -o %OBJDIR%\disk_image.o
+if %errorlevel% neq 0 goto :error
+
+%CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\command_table.c -o %OBJDIR%\command_table.o
+if %errorlevel% neq 0 goto :error
+
 %CC% %CFLAGS% %INCLUDES% -c %SRCDIR%\commands.c -o %OBJDIR%\commands.o
 if %errorlevel% neq 0 goto :error
 
@@ -51,7 +78,7 @@ if %errorlevel% neq 0 goto :error
 
 REM 链接生成可执行文件
 echo 正在链接...
-%CC% %OBJDIR%\*.o -o %BINDIR%\%TARGET%.exe
+%CC% %OBJDIR%\*.o -pthread -o %BINDIR%\%TARGET%.exe
 if %errorlevel% neq 0 goto :error
 
 echo.
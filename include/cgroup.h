@@ -0,0 +1,20 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include <stddef.h>
+
+// cgroup v2 放置（--cgroup DIR|auto）：引导时在一个可写的 cgroup 目录下建 neuminios-<pid>，
+// 每次 run 在其中新建 run-<n>，子进程在 exec 之前把自己写进 cgroup.procs。
+// 子进程连同它再派生的进程都留在这个 cgroup 里，便于宿主机上统一观察和限制。
+#define CGROUP_ROOT "/sys/fs/cgroup"  // 在 /proc/self/mounts 中找不到 cgroup2 挂载点时使用
+#define MAX_CGROUP_PATH 256
+
+// 函数声明
+int init_cgroup(const char* parent);
+int cgroup_enabled(void);
+int create_run_cgroup(char* path, size_t size);
+void remove_run_cgroup(const char* path);
+int join_cgroup(const char* path);
+void cleanup_cgroup(void);
+
+#endif // CGROUP_H
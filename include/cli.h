@@ -1,8 +1,11 @@
 #ifndef CLI_H
 #define CLI_H
 
+#include <stddef.h>
+
 #define MAX_INPUT_LENGTH 256
 #define MAX_HISTORY 100
+#define BATCH_BUFFER_SIZE (256 * 1024) // 批处理模式的读缓冲区（一次 read 尽量读满，也是一行的长度上限）
 
 // 淇：命令历史结构（加分项）
 typedef struct {
@@ -12,19 +15,40 @@ typedef struct {
     int max_size;        // 最大历史记录数
 } CommandHistory;
 
+// 淇：解析后的命令结构
+// 可重复使用：每行命令的所有单词（去掉引号和转义后）依次写进同一块 buffer，args 指向 buffer 内部，
+// buffer 和 args 只在不够用时扩大，解析一行命令通常不分配内存
+typedef struct {
+    char* command;      // 命令名（即 args[0]）
+    char** args;        // 参数数组（含命令名）
+    int arg_count;      // 参数数量
+    int arg_capacity;   // args 的容量
+    char* buffer;       // 单词存储区
+    size_t buffer_size; // buffer 的容量
+} ParsedCommand;
+
+// 批处理模式的输入（-f 脚本或管道）：整块读入缓冲区，逐行切出命令，不切换终端模式、不重绘
+typedef struct {
+    int fd;                  // 脚本文件或标准输入
+    const char* source;      // 出错时显示的来源（脚本路径或 "<stdin>"）
+    char* buffer;            // BATCH_BUFFER_SIZE + 1 字节（最后一行没有换行时补 '\0'）
+    size_t start;            // 尚未处理的数据在 buffer 中的范围 [start, end)
+    size_t end;
+    unsigned long line;      // 当前命令的行号（从 1 开始）
+    int skipping;            // 1=正在丢弃超长行的剩余部分
+    int eof;
+} BatchInput;
+
 // 淇：CLI 结构
 typedef struct {
+    ParsedCommand command;   // 每行命令重复使用的解析结果
     CommandHistory* history; // 命令历史（加分项）
     int running;             // CLI 运行状态
+    BatchInput* batch;       // 非 NULL 时为批处理模式
+    int exit_on_error;       // 批处理模式中有命令失败时立即退出（--exit-on-error）
+    int failed;              // 批处理模式中失败的命令数
 } CLI;
 
-// 淇：解析后的命令结构
-typedef struct {
-    char* command;      // 命令名
-    char** args;        // 参数数组
-    int arg_count;      // 参数数量
-} ParsedCommand;
-
 // 前向声明
 struct FileSystem;
 typedef struct FileSystem FileSystem;
@@ -34,10 +58,12 @@ typedef struct Process Process;
 // 函数声明
 CLI* init_cli(void);
 void destroy_cli(CLI* cli);
+int open_batch_input(CLI* cli, const char* path, int exit_on_error);
 void cli_loop(CLI* cli, FileSystem* fs, Process* pm);
 char* read_input(CLI* cli);
-ParsedCommand* parse_command(const char* input);
-void free_parsed_command(ParsedCommand* cmd);
+void init_parsed_command(ParsedCommand* cmd);
+int parse_command(ParsedCommand* cmd, const char* input);
+void release_parsed_command(ParsedCommand* cmd);
 void add_to_history(CLI* cli, const char* command);
 char* get_history_command(CLI* cli, int direction); // direction: -1=上一条, 1=下一条
 
@@ -0,0 +1,54 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include "cli.h"
+#include "file_system.h"
+#include "process.h"
+
+// 命令表：每条命令登记名称、别名、参数个数、处理函数和说明，按名称（含别名）排序后二分查找。
+// 参数个数不对时由命令表输出用法，help 和未知命令的提示也由命令表生成。
+// 内置命令在引导时登记（register_builtin_commands），其他模块可以用 register_command 加入自己的命令。
+#define MAX_COMMAND_ALIASES 2
+#define COMMAND_ARGS_UNLIMITED (-1)
+
+// help 中的分组（按这个顺序输出）
+typedef enum {
+    COMMAND_GROUP_FILE = 0,
+    COMMAND_GROUP_PROCESS,
+    COMMAND_GROUP_DIRECTORY,
+    COMMAND_GROUP_IMAGE,
+    COMMAND_GROUP_SYSTEM,
+    COMMAND_GROUP_COUNT
+} CommandGroup;
+
+// 处理函数可以使用的系统状态
+typedef struct {
+    FileSystem* fs;
+    Process* pm;
+} CommandContext;
+
+// 处理函数：cmd->args[0] 为输入的命令名（可能是别名），参数个数已按表检查；返回值同 execute_command
+typedef int (*CommandHandler)(ParsedCommand* cmd, const CommandContext* ctx);
+
+typedef struct {
+    const char* name;                          // 命令名
+    const char* aliases[MAX_COMMAND_ALIASES];  // 别名，未用的为 NULL
+    int min_args;                              // 参数个数（不含命令名）
+    int max_args;                              // COMMAND_ARGS_UNLIMITED 表示不限
+    CommandGroup group;
+    const char* usage;                         // 用法，多种写法用 '\n' 分隔
+    const char* example;                       // 示例，可为 NULL，多条用 '\n' 分隔
+    const char* help;                          // help 中的一行说明
+    CommandHandler handler;
+} CommandSpec;
+
+// 函数声明
+int register_command(const CommandSpec* spec);
+int register_commands(const CommandSpec* specs, int count);
+const CommandSpec* find_command(const char* name);
+int dispatch_command(ParsedCommand* cmd, const CommandContext* ctx);
+void print_command_usage(const CommandSpec* spec);
+void print_command_help(void);
+void clear_command_table(void);
+
+#endif // COMMAND_TABLE_H
@@ -11,15 +11,31 @@ int execute_copy(FileSystem* fs, const char* src_filename, const char* dest_file
 int execute_rename(FileSystem* fs, const char* old_filename, const char* new_filename);
 int execute_list(FileSystem* fs);
 int execute_view(FileSystem* fs, const char* filename);
+int execute_head_tail(FileSystem* fs, const char* filename, size_t lines, bool from_end); // head / tail <file> [lines]
+int execute_more(FileSystem* fs, const char* filename);                                 // more <file>
+int execute_write(FileSystem* fs, const char* filename, size_t offset, const char* text); // write <file> <offset> <text>
+int execute_append(FileSystem* fs, const char* filename, const char* text);               // append <file> <text>
+int execute_truncate(FileSystem* fs, const char* filename, size_t size);                  // truncate <file> <size>
 int execute_delete(FileSystem* fs, const char* filename);
 int execute_mkdir(FileSystem* fs, const char* dirname);   // mkdir <directory>
 int execute_cd(FileSystem* fs, const char* dirname);      // cd <directory>
+int execute_save_image(FileSystem* fs, const char* image_path); // save-image <host_path>
+int execute_df(FileSystem* fs);                            // df
+int execute_dedup_stats(FileSystem* fs);                   // dedup-stats
 
 // 进程管理 | Process
 int execute_plist(Process* pm);
-int execute_stop(Process* pm, int process_id);
-int execute_run(FileSystem* fs, Process* pm, const char* filename);
-// 主命令分发函数
+int execute_stop(Process* pm, const int* process_ids, int count); // stop <pid> [pid...]
+int execute_stop_all(Process* pm);                               // stop --all
+int execute_run(FileSystem* fs, Process* pm, const char* filename, const RunOptions* options); // run [-p prio] [-n nice] [-c cpus] <file>
+int execute_jobs(int cancel_id);                                  // jobs [--cancel <id>]
+int execute_pipeline(FileSystem* fs, PipelineStage* stages, int count, const char* input_name, const char* output_name); // run a | run b < in > out
+int execute_cache_stats(void);                              // cache-stats
+int execute_plog(int pid, int follow);                            // plog <pid> [-f]
+int execute_ptop(int sort_by_memory, int interval_ms, int frames); // ptop [-m] [-d ms] [-n frames]
+int execute_spawn_bench(FileSystem* fs, const char* filename, int runs, size_t max_mb); // spawn-bench <file> [runs] [max_mb]
+// 主命令分发函数（按 command_table 中登记的命令查找）
+int register_builtin_commands(void);
 int execute_command(ParsedCommand* cmd, FileSystem* fs, Process* pm);
 
 #endif // COMMANDS_H
\ No newline at end of file
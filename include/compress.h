@@ -0,0 +1,18 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+
+// 内置的快速 LZ 压缩（LZ4 风格的字节流格式，不依赖外部库）：
+//   序列 = [token][扩展字面量长度][字面量][2 字节偏移][扩展匹配长度]
+//   token 高 4 位为字面量长度，低 4 位为匹配长度 - COMPRESS_MIN_MATCH，取 15 时后接扩展字节（255 累加）
+//   最后一个序列只有字面量
+#define COMPRESS_MIN_MATCH 4
+#define COMPRESS_MAX_OFFSET 65535
+
+// 函数声明
+size_t compress_bound(size_t size);
+size_t compress_data(const void* src, size_t size, void* dst, size_t capacity);
+int decompress_data(const void* src, size_t stored_size, void* dst, size_t size);
+
+#endif // COMPRESS_H
@@ -0,0 +1,39 @@
+#ifndef DISK_IMAGE_H
+#define DISK_IMAGE_H
+
+#include <stdint.h>
+#include "file_system.h"
+
+// 单文件磁盘镜像格式：
+//   [DiskImageHeader][DiskImageEntry * entry_count][文件名表][数据区]
+// 目录表按先序排列（父目录总在子节点之前），加载时一次遍历即可重建目录树。
+// 所有整数按主机字节序存储，镜像只在同一种架构上读写。
+#define DISK_IMAGE_MAGIC "NEUIMG01"
+#define DISK_IMAGE_VERSION 1
+#define DISK_IMAGE_ALIGN 16          // 数据区内每个文件的对齐
+#define DISK_IMAGE_FLAG_DIR 0x1      // 目录项标志
+
+typedef struct {
+    char magic[8];            // DISK_IMAGE_MAGIC
+    uint32_t version;         // DISK_IMAGE_VERSION
+    uint32_t entry_count;     // 目录表项数量（不含根目录）
+    uint64_t names_offset;    // 文件名表在镜像中的偏移
+    uint64_t names_size;      // 文件名表长度
+    uint64_t data_offset;     // 数据区在镜像中的偏移
+    uint64_t data_size;       // 数据区长度
+} DiskImageHeader;
+
+typedef struct {
+    uint32_t parent;          // 父目录项下标 + 1，0 表示根目录
+    uint32_t flags;           // DISK_IMAGE_FLAG_*
+    uint32_t name_offset;     // 文件名在文件名表中的偏移
+    uint32_t name_length;     // 文件名长度（不含 '\0'）
+    uint64_t data_offset;     // 文件内容在数据区中的偏移
+    uint64_t size;            // 文件大小（目录为 0）
+} DiskImageEntry;
+
+// 函数声明
+int save_disk_image(FileSystem* fs, const char* image_path);
+int load_disk_image(FileSystem* fs, const char* image_path);
+
+#endif // DISK_IMAGE_H
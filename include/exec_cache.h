@@ -0,0 +1,28 @@
+#ifndef EXEC_CACHE_H
+#define EXEC_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_system.h"
+
+// 可执行文件缓存：按文件内容哈希保存已经准备好（写入并封印）的 memfd，
+// 重复 run 同一个程序时直接 fexecve，不再复制内容
+#define EXEC_CACHE_SLOTS 32                    // 最多缓存的程序数
+#define EXEC_CACHE_MAX_BYTES (64u << 20)       // 缓存内容的总字节数上限
+
+typedef struct {
+    uint64_t hash;             // 文件内容哈希（file_content_hash）
+    size_t size;               // 文件大小，与哈希一起作为键
+    int fd;                    // 封印后的 memfd，空槽为 -1
+    unsigned long last_used;   // LRU 时间戳
+} ExecCacheEntry;
+
+// 函数声明
+void init_exec_cache(void);
+void cleanup_exec_cache(void);
+int exec_cache_lookup(uint64_t hash, size_t size);
+int exec_cache_insert(uint64_t hash, size_t size, int fd);
+void exec_cache_file_changed(FileSystem* fs, FileNode* file, void* ctx);
+void print_exec_cache_stats(void);
+
+#endif // EXEC_CACHE_H
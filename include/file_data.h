@@ -0,0 +1,73 @@
+#ifndef FILE_DATA_H
+#define FILE_DATA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEDUP_CHUNK_SIZE 4096        // 去重块大小（固定分块）
+#define COMPRESS_MAX_RATIO 90        // 压缩后不超过原大小的这个百分比才保存压缩形式
+
+// 文件内容的存储方式（决定释放和修改时的处理）
+typedef enum {
+    FILE_STORAGE_HEAP = 0,     // malloc 分配
+    FILE_STORAGE_MMAP,         // 主机文件的只读私有映射（零拷贝）
+    FILE_STORAGE_IMAGE,        // 指向整个磁盘镜像映射内部，随 FileSystem 一起解除映射
+    FILE_STORAGE_LAZY,         // 引导时只记录主机路径，首次访问时读入堆缓冲区（data 可能为 NULL）
+    FILE_STORAGE_CHUNKED,      // 内容切成固定大小的块存放在去重块存储中（data 为 NULL）
+    FILE_STORAGE_COMPRESSED    // data 为压缩后的内容（stored_size 字节），读取时解压到 FileSystem 的解压缓存
+} FileStorage;
+
+// 去重块：按内容哈希登记在 BlockStore 中，相同内容的块只存一份
+typedef struct DataChunk {
+    uint64_t hash;             // 内容哈希
+    size_t length;             // 块长度（最后一块可能不足 DEDUP_CHUNK_SIZE）
+    int refcount;              // 引用该块的次数（同一文件内重复的块也分别计数）
+    struct DataChunk* next;    // 同一个桶内的下一个块
+    unsigned char bytes[];     // 块内容
+} DataChunk;
+
+// 内容寻址的去重块存储（只在主线程的文件系统操作中访问）
+typedef struct BlockStore {
+    DataChunk** buckets;       // 按哈希分桶
+    size_t bucket_count;       // 桶数量（2 的幂）
+    size_t chunk_count;        // 不同块的数量
+    size_t chunk_refs;         // 块引用总数
+    size_t logical_bytes;      // 所有引用加起来的字节数（去重前）
+    size_t stored_bytes;       // 实际保存的字节数（去重后）
+} BlockStore;
+
+// 文件内容缓冲区：可被多个文件节点共享（copy 只增加引用计数），写之前再按需克隆
+// refcount 和延迟加载的 data 由所属 FileSystem 的 data_lock 保护
+typedef struct FileBuffer {
+    int refcount;              // 引用该缓冲区的文件节点数
+    FileStorage storage;       // data 的来源
+    void* data;                // 内容指针（延迟加载且尚未读入时为 NULL）
+    size_t size;               // 内容长度（字节）
+    size_t capacity;           // 堆缓冲区实际分配的字节数（append 可以继续写入 size 之后的空间）
+    size_t stored_size;        // 实际占用的字节数（压缩存储时为压缩后长度，其余等于 size）
+    char* host_path;           // 延迟加载时的主机路径，其余情况为 NULL
+    DataChunk** chunks;        // 分块存储时的块列表，其余情况为 NULL
+    size_t chunk_count;        // 块数量
+} FileBuffer;
+
+// 文件区段：引用某个缓冲区中的一段连续内容，文件内容就是各区段按顺序拼接的结果
+// 写入 / 追加 / 截断只改区段列表，不改动可能被共享的旧缓冲区
+typedef struct {
+    FileBuffer* buffer;        // 引用的缓冲区（每个区段持有一个引用）
+    size_t offset;             // 在缓冲区中的起始偏移
+    size_t length;             // 区段长度
+} FileExtent;
+
+// 函数声明
+FileBuffer* create_file_buffer(void* data, size_t size, FileStorage storage);
+FileBuffer* create_lazy_buffer(const char* host_path, size_t size);
+FileBuffer* create_chunked_buffer(BlockStore* store, const void* data, size_t size);
+FileBuffer* create_compressed_buffer(void* packed, size_t stored_size, size_t size);
+void* compress_file_data(const void* data, size_t size, size_t* stored_size);
+void free_file_buffer(BlockStore* store, FileBuffer* buffer);
+void free_storage_data(void* data, size_t size, FileStorage storage);
+BlockStore* create_block_store(void);
+void destroy_block_store(BlockStore* store);
+void* read_host_data(const char* host_path, size_t size);
+
+#endif // FILE_DATA_H
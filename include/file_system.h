@@ -2,40 +2,107 @@
 #define FILE_SYSTEM_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include "file_data.h"
 
 // 文件节点结构（含链表）
 typedef struct FileNode {
     char* filename;           // 文件名
     char* path;               // 文件路径（用于目录支持）
-    void* data;                // 文件内容的内存指针
-    size_t size;               // 文件大小（字节）
+    FileExtent* extents;       // 文件内容的区段列表（缓冲区可被 copy 出来的多个节点共享，目录为 NULL）
+    size_t extent_count;       // 区段数量
+    size_t extent_capacity;    // 区段数组容量
+    size_t size;               // 文件大小（字节，等于各区段长度之和）
+    uint64_t content_hash;     // 内容哈希（file_content_hash 第一次计算后缓存，内容修改时失效）
+    bool content_hash_valid;   // content_hash 是否有效
     bool is_directory;         // 是否为目录（false=文件, true=目录）
     struct FileNode* children; // 子文件/目录（用于目录层次）
     struct FileNode* next;     // 同级文件/目录（链表指针）
+    struct FileNode* prev;     // 同级前驱（O(1) 摘除节点）
     struct FileNode* parent;   // 父目录指针
+    // 目录索引（仅目录使用）：children 链表保持插入顺序，哈希表负责按名查找
+    struct FileNode* tail;     // children 链表尾，追加为 O(1)
+    struct FileNode** buckets; // 按文件名哈希的桶数组
+    size_t bucket_count;       // 桶数量（2 的幂，0 表示尚未分配）
+    size_t child_count;        // 子节点数量
+    struct FileNode* hash_next; // 同一个桶内的下一个节点
 } FileNode;
 
+// 文件内容片段回调：返回非0时停止遍历
+typedef int (*FileSegmentFn)(const void* data, size_t length, void* ctx);
+
+struct FileSystem;
+// 文件被删除、改名或内容即将被修改时的通知（exec 缓存据此丢弃过期的项）
+typedef void (*FileChangeFn)(struct FileSystem* fs, FileNode* file, void* ctx);
+
 // 文件系统结构
+#define DECOMPRESS_CACHE_SLOTS 8                  // 解压缓存最多保留的文件数
+#define DECOMPRESS_CACHE_MAX_BYTES (4 << 20)      // 解压缓存的总字节数上限
+
+// 最近解压过的压缩文件内容（按 FileBuffer 登记，LRU 淘汰）
+typedef struct {
+    FileBuffer* buffer;        // 对应的压缩缓冲区，空槽为 NULL
+    void* data;                // 解压后的内容（buffer->size 字节）
+    unsigned long last_used;   // 最近一次访问的时钟值
+} DecompressCacheEntry;
+
+typedef struct {
+    DecompressCacheEntry entries[DECOMPRESS_CACHE_SLOTS];
+    size_t bytes;              // 缓存中解压内容的总字节数
+    unsigned long clock;       // 访问计数，用作 LRU 时间戳
+    size_t hits;               // 命中次数
+    size_t misses;             // 未命中（需要解压）次数
+} DecompressCache;
+
 typedef struct FileSystem {
     FileNode* root;           // 根节点
     FileNode* current_dir;    // 当前目录
-    size_t total_size;        // 磁盘镜像总大小
+    size_t total_size;        // 磁盘镜像总大小（逻辑大小，共享内容的文件各算一份）
+    size_t physical_size;     // 去掉共享后实际的内容字节数（每个 FileBuffer 只算一次）
+    size_t resident_size;     // 内容已在内存中的字节数（延迟加载的文件读入后才计入）
+    pthread_mutex_t data_lock; // 保护 FileBuffer 的引用计数、延迟加载的 data 以及上面两个统计值
+    void* image_base;         // 从镜像文件启动时的整体映射（见 disk_image.c），否则为 NULL
+    size_t image_size;        // 镜像映射长度
+    BlockStore* block_store;  // 去重块存储（--dedup 时启用），否则为 NULL
+    size_t compressed_files;  // 压缩存储的缓冲区数量
+    size_t compressed_bytes;  // 这些缓冲区解压后的总字节数（压缩后的字节数已计入 physical_size）
+    DecompressCache decompress_cache; // 最近解压的内容（只在 CLI 线程中读取文件时使用）
+    FileChangeFn change_hook; // 文件变化通知（可为 NULL）
+    void* change_ctx;         // 透传给 change_hook 的参数
 } FileSystem;
 
 // 函数声明（顺序与 src/file_system.c 中实现保持一致）
 FileSystem* init_file_system(void);
+int enable_dedup(FileSystem* fs);
 void destroy_file_system(FileSystem* fs);
+void set_file_change_hook(FileSystem* fs, FileChangeFn hook, void* ctx);
 FileNode* add_file(FileSystem* fs, const char* filename, const char* path, void* data, size_t size);
+FileNode* adopt_file(FileSystem* fs, const char* filename, const char* path, void* data, size_t size, FileStorage storage);
+FileNode* adopt_compressed_file(FileSystem* fs, const char* filename, const char* path, void* packed, size_t stored_size, size_t size);
+FileNode* add_lazy_file(FileSystem* fs, const char* filename, const char* path, const char* host_path, size_t size);
+int for_each_file_range(FileSystem* fs, FileNode* file, size_t offset, size_t length, FileSegmentFn fn, void* ctx);
+int for_each_file_segment(FileSystem* fs, FileNode* file, FileSegmentFn fn, void* ctx);
+int file_content_hash(FileSystem* fs, FileNode* file, uint64_t* hash);
+int write_to_file(FileSystem* fs, const char* filename, size_t offset, const void* data, size_t length);
+int append_to_file(FileSystem* fs, const char* filename, const void* data, size_t length);
+int truncate_file(FileSystem* fs, const char* filename, size_t size);
 FileNode* find_file(FileSystem* fs, const char* filename);
 FileNode* copy_file(FileSystem* fs, const char* src_filename, const char* dest_filename);
 int rename_file(FileSystem* fs, const char* old_filename, const char* new_filename);
+int replace_file(FileSystem* fs, const char* source, const char* target);
 void list_files(FileSystem* fs);
 int view_file(FileSystem* fs, const char* filename);
+int view_file_range(FileSystem* fs, const char* filename, size_t offset, size_t length);
+int view_file_lines(FileSystem* fs, const char* filename, size_t lines, bool from_end);
 int delete_file(FileSystem* fs, const char* filename);
 FileNode* create_directory(FileSystem* fs, const char* dirname);
 int change_directory(FileSystem* fs, const char* dirname);
+void print_disk_usage(FileSystem* fs);
+void print_dedup_stats(FileSystem* fs);
 void print_file_info(FileNode* file);
+int write_file_to_fd(FileSystem* fs, FileNode* file, int fd);
 int extract_file_to_host(FileSystem* fs, const char* filename, const char* host_path);
 
 #endif // FILE_SYSTEM_H
\ No newline at end of file
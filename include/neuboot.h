@@ -7,10 +7,35 @@
 
 // 引导加载器配置
 #define DEFAULT_FILES_DIR "./neuminios_files"
+#define MAX_BOOT_THREADS 64      // 引导加载工作线程数上限
+#define DEFAULT_COMPRESS_MIN_SIZE 256 // --compress 时参与压缩的最小文件大小（字节）
+
+// 引导选项（由 main 的命令行参数解析得到）
+typedef struct {
+    int use_mmap;            // 1=以只读 mmap 方式零拷贝加载主机文件（--mmap）
+    const char* image_path;  // 非 NULL 时从单文件磁盘镜像启动（--image <path>）
+    int dedup;               // 1=文件内容切块去重后保存（--dedup）
+    int lazy_load;           // 1=只记录元数据，文件内容首次访问时再读入（--lazy）
+    int boot_threads;        // 加载主机目录的工作线程数，0=按 CPU 数自动选择（--threads N）
+    int compress;            // 1=压缩率足够的文件以压缩形式保存（--compress）
+    size_t compress_min_size; // 小于这个大小的文件不压缩（--compress-min N）
+    SpawnBackend spawn_backend; // run 启动子进程的方式（--spawn posix|fork）
+    int use_zygote;          // 1=加载镜像前分出 zygote 进程，由它代为启动子进程（--zygote）
+    int max_processes;       // 进程表容量（--max-procs N）
+    int max_running;         // 同时运行的进程数上限，超出的 run 排队；0=与进程表容量相同（--max-running N|cpus）
+    int capture_output;      // 1=子进程的输出读进环形缓冲区，用 plog 查看（--capture）
+    size_t output_ring_size; // 每个进程保留的输出字节数（--log-size N）
+    int stop_grace_ms;       // stop 发出 SIGTERM 后等待的毫秒数，超时改发 SIGKILL（--stop-grace MS）
+    const char* cgroup_parent; // 每次 run 放进这个 cgroup v2 目录下的新 cgroup，NULL=不使用（--cgroup DIR|auto）
+    const char* script_path; // 非 NULL 时从脚本文件读取命令（-f FILE）；标准输入不是终端时同样进入批处理模式
+    int exit_on_error;       // 1=批处理模式中有命令失败时立即退出（--exit-on-error）
+} BootOptions;
 
 // 函数声明
-void neuboot_start(void);
-int load_files_from_directory(FileSystem* fs, const char* directory_path);
+void init_boot_options(BootOptions* opts);
+int parse_boot_options(int argc, char* argv[], BootOptions* opts);
+int neuboot_start(const BootOptions* opts);
+int load_files_from_directory(FileSystem* fs, const char* directory_path, const BootOptions* opts);
 void display_boot_info(FileSystem* fs);  // 加分项：显示启动信息
 size_t calculate_directory_size(const char* directory_path);
 
@@ -0,0 +1,25 @@
+#ifndef OUTPUT_RING_H
+#define OUTPUT_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 子进程输出的环形缓冲区：容量固定，写满后覆盖最旧的内容（从不阻塞子进程）。
+// 读者用"已写入的总字节数"作为位置，落后超过一圈时跳过被覆盖的部分并得知丢了多少字节。
+#define DEFAULT_OUTPUT_RING_SIZE (64u << 10)   // 每个进程默认保留的输出字节数
+#define MIN_OUTPUT_RING_SIZE 1024
+#define MAX_OUTPUT_RING_SIZE (64u << 20)
+
+typedef struct {
+    char* data;               // 第一次写入时才分配，没有输出的进程不占内存
+    size_t capacity;
+    uint64_t written;         // 累计写入的字节数，data[written % capacity] 是下一个写入位置
+} OutputRing;
+
+// 函数声明
+OutputRing* create_output_ring(size_t capacity);
+void destroy_output_ring(OutputRing* ring);
+int output_ring_append(OutputRing* ring, const char* data, size_t length);
+size_t output_ring_read(const OutputRing* ring, uint64_t* position, char* buffer, size_t size, uint64_t* dropped);
+
+#endif // OUTPUT_RING_H
@@ -0,0 +1,21 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include "file_system.h"
+
+// run a | run b < in > out 的数据搬运，在 CLI 线程中前台进行（文件系统只在 CLI 线程中访问）：
+// - < file：文件的各个片段用 vmsplice 直接挂进第一级的输入管道，不复制到中间缓冲区；
+// - > file：最后一级的输出管道用 splice 移进一个 memfd，结束后把 memfd 映射成磁盘镜像中的新文件。
+// 各级之间的数据由内核在管道中传递，NeuMiniOS 不参与。
+#define PIPELINE_MAX_STAGES 8          // 一条管道最多的级数
+#define PIPELINE_SPLICE_SIZE (1 << 20) // 每次 splice 最多移动的字节数
+#define PIPELINE_POLL_MS 100
+
+// 函数声明
+int open_pipeline_pipe(int fds[2]);
+int create_pipeline_sink(void);
+int pump_pipeline(FileSystem* fs, FileNode* input, int input_fd, int output_fd, int sink_fd, uint64_t* collected);
+int store_pipeline_output(FileSystem* fs, const char* filename, int sink_fd, uint64_t size);
+
+#endif // PIPELINE_H
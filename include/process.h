@@ -2,10 +2,23 @@
 #define PROCESS_H
 // 防止头文件重复包含（进程管理）
 
+#include <stddef.h>
 #include <sys/types.h>// 提供 pid_t 类型（进程ID类型）
+#include <time.h>
+#include <stdint.h>
+#include "output_ring.h"
+#include "cgroup.h"
 
-#define MAX_PROCESSES 5// 最大进程数限制
+#define DEFAULT_MAX_PROCESSES 64// 默认进程表容量（引导参数 --max-procs N 可调整）
+#define MAX_PROCESS_LIMIT 65536// 进程表容量上限
 #define MAX_PROCESS_NAME 256// 进程名称最大长度
+#define DEFAULT_STOP_GRACE_MS 3000// stop 发出 SIGTERM 后等待的宽限期（引导参数 --stop-grace MS 可调整）
+#define MAX_STOP_GRACE_MS 600000// 宽限期上限（10 分钟）
+#define MAX_QUEUED_JOBS 1024// 等待启动的作业数上限（每个作业持有一个可执行文件的 fd）
+#define MAX_CPU_LIST 64// CPU 亲和性列表（如 "0-3,6"）的最大长度
+#define MAX_JOB_PRIORITY 1000// run -p 的取值范围为 -MAX_JOB_PRIORITY ~ MAX_JOB_PRIORITY
+#define PIPELINE_PIPE_SIZE (1 << 20)// 管道相邻两级之间的管道缓冲区大小
+#define LIMIT_UNSET (-1LL)// 资源限制未设置：子进程继承 NeuMiniOS 的限制
 
 // ruby(数组版本)：
 /*
@@ -20,20 +33,119 @@ static Process process_table[MAX_PROCESSES]; // 固定大小数组存储进程
 static int next_pid = 1;                     // NeuMiniOS 下一个可用 PID
 */
 
-// 进程信息结构（链表节点实现）
+// 子进程启动方式
+typedef enum {
+    SPAWN_BACKEND_POSIX_SPAWN = 0, // posix_spawn（vfork 语义，不复制地址空间），默认
+    SPAWN_BACKEND_FORK             // fork + exec（posix_spawn 不可用时的后备）
+} SpawnBackend;
+
+// stop 的进度：stop 发出 SIGTERM 后立即返回，回收线程在截止时间到达时改发 SIGKILL，结果在下一个提示符前报告
+typedef enum {
+    STOP_NONE = 0,               // 没有被 stop
+    STOP_TERM_SENT,              // 已发 SIGTERM，等待宽限期
+    STOP_KILL_SENT,              // 宽限期内没有退出，已改发 SIGKILL
+    STOP_ABANDONED               // SIGKILL 之后仍未退出，已报告错误
+} StopState;
+
+// 子进程的标准输入 / 输出 / 错误（管道、输出捕获管道或 /dev/null），-1 表示继承 NeuMiniOS 的终端
+typedef struct {
+    int input;
+    int output;
+    int error;
+} ChildStdio;
+
+// run 的资源限制和调度属性：子进程 fork 之后、exec 之前设置，程序从第一条指令起就在限制之下运行
+// （rlimit 软硬限制相同，子进程不能再调高）
+typedef struct {
+    long long address_space;     // RLIMIT_AS（字节）
+    long long cpu_seconds;       // RLIMIT_CPU（秒），超出时收到 SIGXCPU，再过 1 秒 SIGKILL
+    long long open_files;        // RLIMIT_NOFILE
+    long long core_size;         // RLIMIT_CORE（字节），0 表示不产生 core dump
+    char cgroup[MAX_CGROUP_PATH]; // exec 之前加入的 cgroup 目录（--cgroup），空串表示不移动
+    int nice;                    // 子进程的 nice 值（-20 ~ 19）
+    int has_nice;                // 0=不修改 nice
+    char cpus[MAX_CPU_LIST];     // 允许运行的 CPU 列表，空串表示不限制
+} ProcessLimits;
+
+// run 的调度选项：并发数达到上限时作业排队，按优先级从高到低、同优先级按提交顺序启动
+typedef struct {
+    int priority;                // 越大越先启动，默认 0
+    ProcessLimits limits;        // 资源限制、nice 和 CPU 亲和性（plist 中显示实际生效的限制）
+} RunOptions;
+
+// 管道（run a | run b）中的一级
+typedef struct {
+    const char* name;            // 程序名
+    int exec_fd;                 // 已封印的可执行文件 memfd（启动后调用者关闭）
+    RunOptions options;
+} PipelineStage;
+
+// 进程信息结构（进程表槽位）
 typedef struct Process {
-    int pid;                     // NeuMiniOS 进程 ID（唯一）
+    int pid;                     // NeuMiniOS 进程 ID（代数 * 容量 + 槽位下标 + 1）
     pid_t system_pid;            // Linux 系统进程 ID
-    int status;                  
+    int status;                  // 0=空闲槽位, 1=运行中
     char name[MAX_PROCESS_NAME]; 
-    struct Process* next;        // 指向下一个进程节点
+    unsigned int generation;     // 槽位被重复使用的代数，PID 的代数与之不符时视为已失效
+    int prev;                    // 启动顺序链表中的前一个槽位（-1 表示无）
+    int next;                    // 启动顺序链表中的后一个槽位（-1 表示无）
+    int pidfd;                   // 回收线程监视的 pidfd（-1 表示轮询）
+    struct timespec start_time;  // 登记时间（CLOCK_MONOTONIC），用于计算运行时长
+    int output_fd;               // 输出捕获管道的读端（-1 表示输出直接写到终端）
+    OutputRing* output;          // 捕获的输出（--capture）
+    RunOptions options;          // 启动时的调度选项（jobs 中显示）
+    StopState stop_state;        // stop 的进度
+    struct timespec stop_deadline; // 当前阶段的截止时间（CLOCK_MONOTONIC）：宽限期结束，或 SIGKILL 后放弃等待
 } Process;
 
+// 进程资源使用情况：运行中的进程从 /proc/<pid>/stat 和 status 采样，已退出的取自 wait4 的 rusage
+typedef struct {
+    double user_seconds;         // 用户态 CPU 时间
+    double system_seconds;       // 内核态 CPU 时间
+    long rss_kb;                 // 当前常驻内存（已退出为 0）
+    long max_rss_kb;             // 常驻内存峰值
+    long voluntary_switches;     // 主动上下文切换（等待 I/O、sleep）
+    long involuntary_switches;   // 被动上下文切换（时间片用完被抢占）
+    double uptime_seconds;       // 从启动到现在（或到退出）的时长
+    char state;                  // /proc 中的状态字符（R/S/D/Z/T...），已退出为 'X'
+} ProcessUsage;
+
 // ruby: 进程管理对外 API，进程管理函数声明
-void init_process_table(void);
-int create_process(const char* program_name, const char* program_path);
+int init_process_table(int capacity);
+int get_process_capacity(void);
+int create_exec_memfd(const char* program_name);
+int seal_exec_memfd(int fd);
+void init_run_options(RunOptions* options);
+void init_process_limits(ProcessLimits* limits);
+int has_process_limits(const ProcessLimits* limits);
+int apply_process_limits(const ProcessLimits* limits);
+int validate_cpu_list(const char* cpus);
+int create_process(const char* program_name, const char* program_path, const RunOptions* options);
+int create_process_from_fd(const char* program_name, int exec_fd, const RunOptions* options);
+int create_pipeline(const PipelineStage* stages, int count, int input_fd, int output_fd);
+void set_max_running(int limit);
+int get_max_running(void);
+void list_jobs(void);
+int cancel_job(int job_id);
+pid_t launch_program(const char* program_name, const char* program_path, int exec_fd,
+                     SpawnBackend backend, const ChildStdio* stdio, const ProcessLimits* limits, int* error);
+void redirect_child_stdio(const ChildStdio* stdio);
+void set_spawn_backend(SpawnBackend backend);
+SpawnBackend get_spawn_backend(void);
+int benchmark_spawn(const char* program_name, int exec_fd, int runs, size_t max_mb);
 int stop_process(int pid);
+int stop_processes(const int* pids, int count);
+int stop_all_processes(void);
+void set_stop_grace(int grace_ms);
+void set_output_capture(int enabled, size_t ring_size);
+void set_child_input(int fd);
+ssize_t read_process_output(int pid, uint64_t* position, char* buffer, size_t size,
+                            uint64_t* dropped, int* running);
+int get_stop_grace(void);
 void list_processes(void);
+void report_process_events(void);
+int print_process_top(int sort_by_memory);
+void reset_process_top(void);
 void cleanup_process_table(void);
 
 
@@ -0,0 +1,39 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include "process.h"
+
+// zygote：引导阶段（加载磁盘镜像之前）分出的小进程，代替 NeuMiniOS 主进程 fork / exec 子进程。
+// 主进程通过 socketpair 发送启动请求（可执行文件和标准输入 / 输出 / 错误的 fd + argv），zygote 启动后回复系统 PID。
+// zygote 的地址空间很小，启动耗时不随磁盘镜像增大而增长。
+// 子进程以 CLONE_PARENT 创建，父进程是主进程，由主进程的回收线程等待。
+#define ZYGOTE_MAX_MESSAGE 4096      // 单个启动请求的最大长度
+#define ZYGOTE_FLAG_FD 0x1           // 请求附带了可执行文件的 fd（SCM_RIGHTS）
+#define ZYGOTE_FLAG_OUTPUT 0x2       // 请求附带了子进程标准输出的 fd（管道、输出捕获管道或 /dev/null）
+#define ZYGOTE_FLAG_INPUT 0x4        // 请求附带了子进程标准输入的 fd（管道）
+#define ZYGOTE_FLAG_ERROR 0x8        // 请求附带了子进程标准错误的 fd（输出捕获管道或 /dev/null）
+#define ZYGOTE_MAX_FDS 4             // 一个请求最多附带的 fd：可执行文件、输入、输出、错误
+
+// 启动请求头，后面紧跟以 '\0' 分隔的程序路径和程序名
+typedef struct {
+    uint32_t flags;           // ZYGOTE_FLAG_*
+    uint32_t length;          // 头之后的字节数
+    ProcessLimits limits;     // 子进程 exec 之前设置的资源限制、nice 和 CPU 亲和性（两端是同一个程序，按内存布局传递）
+} ZygoteRequest;
+
+// 启动结果
+typedef struct {
+    int32_t pid;              // 子进程的系统 PID，clone 失败为 -1（exec 失败时仍是子进程的 PID）
+    int32_t error;            // 失败时的 errno，成功为 0
+} ZygoteReply;
+
+// 函数声明
+int start_zygote(void);
+void stop_zygote(void);
+int zygote_running(void);
+pid_t zygote_launch(const char* program_name, const char* program_path, int exec_fd, const ChildStdio* stdio,
+                    const ProcessLimits* limits, int* error);
+
+#endif // ZYGOTE_H
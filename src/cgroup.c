@@ -0,0 +1,145 @@
+#include "../include/cgroup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// ruby(cgroup)：NeuMiniOS 自己的 cgroup 目录，为空表示未启用
+static char cgroup_base[MAX_CGROUP_PATH] = "";
+static unsigned long next_run_cgroup = 1;
+static pthread_mutex_t cgroup_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// cgroup2 的挂载点：纯 v2 系统为 /sys/fs/cgroup，v1/v2 混合的系统通常是 /sys/fs/cgroup/unified
+static void find_cgroup2_mount(char* path, size_t size) {
+    snprintf(path, size, "%s", CGROUP_ROOT);
+    FILE* fp = fopen("/proc/self/mounts", "r");
+    if (!fp) return;
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        // 设备 挂载点 类型 选项 ...
+        char* saveptr = NULL;
+        strtok_r(line, " ", &saveptr);
+        char* mount_point = strtok_r(NULL, " ", &saveptr);
+        char* type = strtok_r(NULL, " ", &saveptr);
+        if (mount_point && type && strcmp(type, "cgroup2") == 0) {
+            snprintf(path, size, "%s", mount_point);
+            break;
+        }
+    }
+    fclose(fp);
+}
+
+// 从 /proc/self/cgroup 的 "0::/path" 一行得到本进程所在的 cgroup v2 目录，失败返回-1
+static int find_own_cgroup(char* path, size_t size) {
+    char root[MAX_CGROUP_PATH];
+    find_cgroup2_mount(root, sizeof(root));
+    FILE* fp = fopen("/proc/self/cgroup", "r");
+    if (!fp) return -1;
+    char line[MAX_CGROUP_PATH];
+    int found = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "0::", 3) != 0) continue;
+        line[strcspn(line, "\n")] = '\0';
+        // 根 cgroup 为 "/"，去掉它避免出现 "//"
+        const char* own = strcmp(line + 3, "/") == 0 ? "" : line + 3;
+        if (snprintf(path, size, "%s%s", root, own) < (int)size) found = 0;
+        break;
+    }
+    fclose(fp);
+    return found;
+}
+
+/*
+ * 启用 cgroup 放置
+ *
+ * @param parent  可写的 cgroup v2 目录，"auto" 表示本进程所在的 cgroup
+ *
+ * @return 成功返回0，目录不是 cgroup v2 或没有写权限返回-1（errno 说明原因）
+ */
+int init_cgroup(const char* parent) {
+    char directory[MAX_CGROUP_PATH];
+    if (strcmp(parent, "auto") == 0) {
+        if (find_own_cgroup(directory, sizeof(directory)) != 0) {
+            errno = ENOENT;
+            return -1;
+        }
+    } else if (snprintf(directory, sizeof(directory), "%s", parent) >= (int)sizeof(directory)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    // cgroup v2 目录一定有 cgroup.procs
+    char procs[MAX_CGROUP_PATH + 16];
+    snprintf(procs, sizeof(procs), "%s/cgroup.procs", directory);
+    if (access(procs, W_OK) != 0) return -1;
+
+    char base[MAX_CGROUP_PATH];
+    if (snprintf(base, sizeof(base), "%s/neuminios-%d", directory, (int)getpid()) >= (int)sizeof(base)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (mkdir(base, 0755) != 0 && errno != EEXIST) return -1;
+    snprintf(cgroup_base, sizeof(cgroup_base), "%s", base);
+    return 0;
+}
+
+int cgroup_enabled(void) {
+    return cgroup_base[0] != '\0';
+}
+
+// 为一次 run 新建 cgroup 目录，路径写入 path；未启用或创建失败返回-1
+int create_run_cgroup(char* path, size_t size) {
+    if (!cgroup_enabled()) return -1;
+    pthread_mutex_lock(&cgroup_lock);
+    unsigned long id = next_run_cgroup++;
+    pthread_mutex_unlock(&cgroup_lock);
+    if (snprintf(path, size, "%s/run-%lu", cgroup_base, id) >= (int)size || mkdir(path, 0755) != 0) {
+        path[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+// 删除 run 的 cgroup 目录；子进程派生的进程还在里面时删除失败，目录保留
+void remove_run_cgroup(const char* path) {
+    if (path && path[0]) rmdir(path);
+}
+
+/*
+ * 把调用进程移进 path 指向的 cgroup（在子进程 fork 之后、exec 之前调用）
+ *
+ * 只用 fork 之后可以安全调用的函数：不分配内存，不用 stdio
+ *
+ * @return 成功返回0，失败返回-1（errno 说明原因）
+ */
+int join_cgroup(const char* path) {
+    static const char procs_name[] = "/cgroup.procs";
+    char procs[MAX_CGROUP_PATH + sizeof(procs_name)];
+    size_t length = strlen(path);
+    if (length >= MAX_CGROUP_PATH) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(procs, path, length);
+    memcpy(procs + length, procs_name, sizeof(procs_name));
+
+    int fd = open(procs, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    // 写入 "0" 表示移动写入者自己
+    ssize_t n = write(fd, "0", 1);
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return n == 1 ? 0 : -1;
+}
+
+// 删除 NeuMiniOS 的 cgroup 目录（所有子进程已经退出）
+void cleanup_cgroup(void) {
+    if (!cgroup_enabled()) return;
+    rmdir(cgroup_base);
+    cgroup_base[0] = '\0';
+}
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
 
@@ -30,11 +32,39 @@ CLI* init_cli(void) {
     cli->history->index = -1;
     cli->history->max_size = MAX_HISTORY;
     
+    init_parsed_command(&cli->command);
     cli->running = 1;
+    cli->batch = NULL;
+    cli->exit_on_error = 0;
+    cli->failed = 0;
     
     return cli;
 }
 
+/*
+ * 切换到批处理模式：从脚本文件（path 非 NULL）或标准输入逐行读取命令
+ *
+ * @param exit_on_error  1=有命令失败时停止执行后面的命令
+ *
+ * @return 成功返回0，打不开脚本或内存不足返回-1
+ */
+int open_batch_input(CLI* cli, const char* path, int exit_on_error) {
+    if (!cli) return -1;
+    BatchInput* batch = (BatchInput*)calloc(1, sizeof(BatchInput));
+    if (!batch) return -1;
+    batch->buffer = (char*)malloc(BATCH_BUFFER_SIZE + 1);
+    batch->fd = path ? open(path, O_RDONLY | O_CLOEXEC) : STDIN_FILENO;
+    if (!batch->buffer || batch->fd < 0) {
+        free(batch->buffer);
+        free(batch);
+        return -1;
+    }
+    batch->source = path ? path : "<stdin>";
+    cli->batch = batch;
+    cli->exit_on_error = exit_on_error;
+    return 0;
+}
+
 // 淇：销毁 CLI
 void destroy_cli(CLI* cli) {
     if (!cli) return;
@@ -46,18 +76,105 @@ void destroy_cli(CLI* cli) {
         free(cli->history->history);
         free(cli->history);
     }
+    release_parsed_command(&cli->command);
+    if (cli->batch) {
+        if (cli->batch->fd != STDIN_FILENO) close(cli->batch->fd);
+        free(cli->batch->buffer);
+        free(cli->batch);
+    }
     
     free(cli);
 }
 
+/*
+ * 批处理模式：取出下一行（去掉行尾的 \r），指向缓冲区内部，下一次调用前有效
+ *
+ * 缓冲区中没有完整的一行时才 read，一次读入尽量多的数据；超过缓冲区的行报错后丢弃。
+ *
+ * @return 下一行，输入结束返回 NULL
+ */
+static char* read_batch_line(BatchInput* batch) {
+    while (1) {
+        char* begin = batch->buffer + batch->start;
+        char* newline = (char*)memchr(begin, '\n', batch->end - batch->start);
+        if (newline || (batch->eof && batch->start < batch->end)) {
+            char* stop = newline ? newline : batch->buffer + batch->end;
+            *stop = '\0';
+            batch->start = (size_t)(stop - batch->buffer) + (newline ? 1 : 0);
+            batch->line++;
+            if (batch->skipping) {
+                batch->skipping = 0;
+                continue;
+            }
+            if (stop > begin && stop[-1] == '\r') stop[-1] = '\0';
+            return begin;
+        }
+        if (batch->eof) return NULL;
+
+        // 把不完整的一行移到缓冲区开头，后面接着读
+        if (batch->start > 0) {
+            memmove(batch->buffer, begin, batch->end - batch->start);
+            batch->end -= batch->start;
+            batch->start = 0;
+        }
+        if (batch->end == BATCH_BUFFER_SIZE) {
+            if (!batch->skipping) {
+                printf("[ERROR] %s:%lu: Line longer than %d bytes, skipped\n",
+                       batch->source, batch->line + 1, BATCH_BUFFER_SIZE);
+            }
+            batch->skipping = 1;
+            batch->end = 0;
+        }
+        ssize_t n = read(batch->fd, batch->buffer + batch->end, BATCH_BUFFER_SIZE - batch->end);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) printf("Error: Failed to read %s: %s\n", batch->source, strerror(errno));
+        if (n <= 0) {
+            batch->eof = 1;
+        } else {
+            batch->end += (size_t)n;
+        }
+    }
+}
+
+// 批处理模式主循环：不显示提示符、不记录历史；空行和 # 开头的行跳过，失败的命令报告行号
+static void batch_loop(CLI* cli, FileSystem* fs, Process* pm) {
+    BatchInput* batch = cli->batch;
+    char* line;
+    while (cli->running && (line = read_batch_line(batch)) != NULL) {
+        report_process_events();
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '\0' || *line == '#') continue;
+
+        int parsed = parse_command(&cli->command, line);
+        if (parsed == 1) continue;
+        int result = parsed == 0 ? execute_command(&cli->command, fs, pm) : -1;
+        if (result == -2) {
+            cli->running = 0;
+        } else if (result < 0) {
+            cli->failed++;
+            printf("[ERROR] %s:%lu: %s\n", batch->source, batch->line, line);
+            if (cli->exit_on_error) {
+                printf("[INFO] Stopping after the first failed command (--exit-on-error)\n");
+                cli->running = 0;
+            }
+        }
+    }
+    report_process_events();
+}
+
 // 淇：CLI 主循环（集成命令执行系统）
 void cli_loop(CLI* cli, FileSystem* fs, Process* pm) {
     if (!cli) return;
+    if (cli->batch) {
+        batch_loop(cli, fs, pm);
+        return;
+    }
     
     char* input;
-    ParsedCommand* cmd;
     
     while (cli->running) {
+        // 提示上一条命令之后退出的后台进程
+        report_process_events();
         input = read_input(cli);
         if (!input) continue;
         
@@ -69,24 +186,15 @@ void cli_loop(CLI* cli, FileSystem* fs, Process* pm) {
         // 淇：添加到历史记录
         add_to_history(cli, input);
         
-        // 淇：解析命令
-        cmd = parse_command(input);
-        if (cmd) {
+        // 淇：解析命令（引号不成对时已显示错误）
+        if (parse_command(&cli->command, input) == 0) {
             // 淇：执行命令
-            int result = execute_command(cmd, fs, pm);
+            int result = execute_command(&cli->command, fs, pm);
             if (result == -2) {
                 // 淇：exit 命令
                 cli->running = 0;
-            } else if (result < 0 && result != -2) {
-                // 淇：命令执行失败，但不退出CLI（错误已在命令函数中显示）
-                // 这里可以添加额外的错误处理逻辑
-            }
-            free_parsed_command(cmd);
-        } else {
-            // 淇：解析失败，但输入不为空，可能是无效命令格式
-            if (strlen(input) > 0) {
-                printf("Error: Invalid command format. Type 'help' for available commands.\n");
             }
+            // 命令执行失败时不退出CLI（错误已在命令函数中显示）
         }
         
         free(input);
@@ -124,6 +232,8 @@ char* read_input(CLI* cli) {
     
     struct termios oldt, newt;
     if (tcgetattr(STDIN_FILENO, &oldt) == -1) {
+        // 标准输入不是终端（引导时已改用批处理模式），不再读取，避免空转
+        cli->running = 0;
         return NULL;
     }
     newt = oldt;
@@ -142,9 +252,11 @@ char* read_input(CLI* cli) {
     while (1) {
         unsigned char ch;
         ssize_t read_bytes = read(STDIN_FILENO, &ch, 1);
+        if (read_bytes < 0 && errno == EINTR) continue;
         if (read_bytes <= 0) {
-            // 读取失败或 EOF
+            // 读取失败或 EOF（终端已关闭）：结束 CLI，而不是反复重试
             tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+            cli->running = 0;
             return NULL;
         }
         
@@ -256,104 +368,104 @@ char* read_input(CLI* cli) {
     }
 }
 
-// 淇：解析命令（增强错误处理）
-ParsedCommand* parse_command(const char* input) {
-    if (!input) {
-        return NULL;
-    }
-    
-    // 淇：跳过前导空白字符
-    while (*input == ' ' || *input == '\t') {
-        input++;
-    }
-    
-    // 淇：检查空输入
-    if (*input == '\0') {
-        return NULL;
-    }
-    
-    ParsedCommand* cmd = (ParsedCommand*)malloc(sizeof(ParsedCommand));
-    if (!cmd) {
-        return NULL;
-    }
-    
-    // 淇：初始化
+// 初始化可重复使用的解析结果（不分配内存，第一次解析时才分配）
+void init_parsed_command(ParsedCommand* cmd) {
     cmd->command = NULL;
-    cmd->args = (char**)malloc(10 * sizeof(char*));
-    if (!cmd->args) {
-        free(cmd);
-        return NULL;
-    }
-    
-    // 淇：初始化参数数组
-    for (int i = 0; i < 10; i++) {
-        cmd->args[i] = NULL;
-    }
+    cmd->args = NULL;
     cmd->arg_count = 0;
-    
-    // 淇：复制输入字符串用于分割
-    char* input_copy = strdup(input);
-    if (!input_copy) {
-        free(cmd->args);
-        free(cmd);
-        return NULL;
-    }
-    
-    // 淇：分割字符串（支持空格和制表符）
-    char* token = strtok(input_copy, " \t\n\r");
-    
-    while (token != NULL && cmd->arg_count < 10) {
-        // 淇：跳过空token
-        if (strlen(token) == 0) {
-            token = strtok(NULL, " \t\n\r");
-            continue;
+    cmd->arg_capacity = 0;
+    cmd->buffer = NULL;
+    cmd->buffer_size = 0;
+}
+
+// 释放解析结果占用的存储区（CLI 销毁时调用）
+void release_parsed_command(ParsedCommand* cmd) {
+    if (!cmd) return;
+    free(cmd->args);
+    free(cmd->buffer);
+    init_parsed_command(cmd);
+}
+
+static int is_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*
+ * 淇：解析一行命令，结果写进 cmd（覆盖上一次的结果）
+ *
+ * 单词以空白分隔；'...' 中的内容原样保留，"..." 中 \" 和 \\ 为转义，引号外 \ 转义下一个字符。
+ * 去掉引号和转义后的单词不会比原文长，所以 buffer 只需与输入一样大；单词个数不限。
+ *
+ * @return 解析出命令返回0，空行返回1，引号不成对或内存不足返回-1（已打印错误）
+ */
+int parse_command(ParsedCommand* cmd, const char* input) {
+    if (!cmd) return -1;
+    cmd->command = NULL;
+    cmd->arg_count = 0;
+    if (!input) return 1;
+
+    size_t needed = strlen(input) + 1;
+    if (needed > cmd->buffer_size) {
+        size_t size = cmd->buffer_size ? cmd->buffer_size : MAX_INPUT_LENGTH;
+        while (size < needed) size *= 2;
+        char* buffer = (char*)realloc(cmd->buffer, size);
+        if (!buffer) {
+            printf("Error: Out of memory while parsing the command\n");
+            return -1;
         }
-        
-        if (cmd->arg_count == 0) {
-            // 淇：第一个token是命令名
-            cmd->command = strdup(token);
-            if (!cmd->command) {
-                free(input_copy);
-                free_parsed_command(cmd);
-                return NULL;
+        cmd->buffer = buffer;
+        cmd->buffer_size = size;
+    }
+
+    const char* p = input;
+    char* out = cmd->buffer;
+    while (1) {
+        while (is_separator(*p)) p++;
+        if (*p == '\0') break;
+
+        char* word = out;
+        char quote = 0;
+        for (; *p != '\0' && (quote || !is_separator(*p)); p++) {
+            if (quote) {
+                if (*p == quote) {
+                    quote = 0;
+                } else if (quote == '"' && *p == '\\' && (p[1] == '"' || p[1] == '\\')) {
+                    *out++ = *++p;
+                } else {
+                    *out++ = *p;
+                }
+            } else if (*p == '\'' || *p == '"') {
+                quote = *p;
+            } else if (*p == '\\' && p[1] != '\0') {
+                *out++ = *++p;
+            } else {
+                *out++ = *p;
             }
         }
-        
-        // 淇：存储参数
-        cmd->args[cmd->arg_count] = strdup(token);
-        if (!cmd->args[cmd->arg_count]) {
-            free(input_copy);
-            free_parsed_command(cmd);
-            return NULL;
+        if (quote) {
+            printf("Error: Unterminated %s quote in command\n", quote == '"' ? "double" : "single");
+            cmd->arg_count = 0;
+            return -1;
         }
-        cmd->arg_count++;
-        
-        token = strtok(NULL, " \t\n\r");
-    }
-    
-    free(input_copy);
-    
-    // 淇：验证命令名存在
-    if (cmd->arg_count == 0 || !cmd->command) {
-        free_parsed_command(cmd);
-        return NULL;
-    }
-    
-    return cmd;
-}
+        *out++ = '\0';
 
-// 淇：释放解析后的命令
-void free_parsed_command(ParsedCommand* cmd) {
-    if (!cmd) return;
-    
-    if (cmd->command) free(cmd->command);
-    if (cmd->args) {
-        for (int i = 0; i < cmd->arg_count; i++) {
-            if (cmd->args[i]) free(cmd->args[i]);
+        if (cmd->arg_count == cmd->arg_capacity) {
+            int capacity = cmd->arg_capacity ? cmd->arg_capacity * 2 : 16;
+            char** args = (char**)realloc(cmd->args, (size_t)capacity * sizeof(char*));
+            if (!args) {
+                printf("Error: Out of memory while parsing the command\n");
+                cmd->arg_count = 0;
+                return -1;
+            }
+            cmd->args = args;
+            cmd->arg_capacity = capacity;
         }
-        free(cmd->args);
+        cmd->args[cmd->arg_count++] = word;
     }
-    free(cmd);
+
+    if (cmd->arg_count == 0) return 1;
+    cmd->command = cmd->args[0];
+    return 0;
 }
 
 // 淇：添加到历史记录
@@ -0,0 +1,218 @@
+#include "../include/command_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HELP_INDENT "                          " // help 中说明文字（"- " 之前）的起始列
+#define HELP_WRAP_WIDTH 40                         // 写法超过这个宽度时说明另起一行
+
+// 查找索引中的一项：名称或别名 -> 命令
+typedef struct {
+    const char* key;
+    const CommandSpec* spec;
+} CommandKey;
+
+// 命令表只在引导阶段和 CLI 线程中访问，不加锁
+static CommandKey* keys = NULL;           // 按 key 排序
+static int key_count = 0;
+static int key_capacity = 0;
+static const CommandSpec** specs = NULL;  // 登记顺序，help 按这个顺序输出
+static int spec_count = 0;
+static int spec_capacity = 0;
+
+static const char* const group_titles[COMMAND_GROUP_COUNT] = {
+    "File Operations", "Process Operations", "Directory Operations (bonus)", "Disk Image", "System"
+};
+static const char* const group_names[COMMAND_GROUP_COUNT] = {
+    "File operations", "Process operations", "Directory operations (bonus)", "Disk image", "System"
+};
+
+// 二分查找 key，找到时返回下标；找不到时返回 -(插入位置 + 1)
+static int search_key(const char* key) {
+    int low = 0, high = key_count - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        int order = strcmp(keys[mid].key, key);
+        if (order == 0) return mid;
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -(low + 1);
+}
+
+static int reserve(void** array, int* capacity, int needed, size_t item_size) {
+    if (needed <= *capacity) return 0;
+    int new_capacity = *capacity ? *capacity * 2 : 32;
+    while (new_capacity < needed) new_capacity *= 2;
+    void* grown = realloc(*array, (size_t)new_capacity * item_size);
+    if (!grown) return -1;
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+/*
+ * 登记一条命令（名称和所有别名）
+ *
+ * spec 不复制，必须在整个运行期间有效（通常是静态数组中的一项）
+ *
+ * @return 成功返回0；名称或别名已被占用、内存不足返回-1（不登记任何一项）
+ */
+int register_command(const CommandSpec* spec) {
+    if (!spec || !spec->name || !spec->handler || spec->group < 0 || spec->group >= COMMAND_GROUP_COUNT) {
+        return -1;
+    }
+    const char* names[1 + MAX_COMMAND_ALIASES];
+    int name_count = 0;
+    names[name_count++] = spec->name;
+    for (int i = 0; i < MAX_COMMAND_ALIASES && spec->aliases[i]; i++) {
+        names[name_count++] = spec->aliases[i];
+    }
+    for (int i = 0; i < name_count; i++) {
+        if (search_key(names[i]) >= 0) {
+            printf("Warning: Command '%s' is already registered\n", names[i]);
+            return -1;
+        }
+        for (int j = 0; j < i; j++) {
+            if (strcmp(names[i], names[j]) == 0) return -1;
+        }
+    }
+    if (reserve((void**)&keys, &key_capacity, key_count + name_count, sizeof(CommandKey)) != 0 ||
+        reserve((void**)&specs, &spec_capacity, spec_count + 1, sizeof(CommandSpec*)) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < name_count; i++) {
+        int position = -(search_key(names[i]) + 1);
+        memmove(&keys[position + 1], &keys[position], (size_t)(key_count - position) * sizeof(CommandKey));
+        keys[position].key = names[i];
+        keys[position].spec = spec;
+        key_count++;
+    }
+    specs[spec_count++] = spec;
+    return 0;
+}
+
+// 登记一组命令，返回登记失败的条数
+int register_commands(const CommandSpec* table, int count) {
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (register_command(&table[i]) != 0) failed++;
+    }
+    return failed;
+}
+
+// 按名称或别名查找命令，找不到返回 NULL
+const CommandSpec* find_command(const char* name) {
+    if (!name) return NULL;
+    int index = search_key(name);
+    return index >= 0 ? keys[index].spec : NULL;
+}
+
+// 逐行输出 text 中以 '\n' 分隔的各条，第一条前加 first，其余前加 rest
+static void print_lines(const char* first, const char* rest, const char* text) {
+    const char* prefix = first;
+    while (text) {
+        const char* newline = strchr(text, '\n');
+        int length = newline ? (int)(newline - text) : (int)strlen(text);
+        printf("%s%.*s\n", prefix, length, text);
+        prefix = rest;
+        text = newline ? newline + 1 : NULL;
+    }
+}
+
+// 输出命令的用法和示例
+void print_command_usage(const CommandSpec* spec) {
+    if (!spec) return;
+    print_lines("Usage: ", "       ", spec->usage ? spec->usage : spec->name);
+    if (spec->example) print_lines("Example: ", "Example: ", spec->example);
+}
+
+// 输出完整的命令说明（help），按分组、登记顺序
+void print_command_help(void) {
+    printf("NeuMiniOS Command Reference:\n");
+    printf("===========================\n");
+    for (int group = 0; group < COMMAND_GROUP_COUNT; group++) {
+        int printed = 0;
+        for (int i = 0; i < spec_count; i++) {
+            const CommandSpec* spec = specs[i];
+            if ((int)spec->group != group) continue;
+            if (!printed) printf("\n%s:\n", group_titles[group]);
+            printed = 1;
+
+            // 第一种写法后接说明，其余写法在说明之后单独成行
+            const char* usage = spec->usage ? spec->usage : spec->name;
+            const char* newline = strchr(usage, '\n');
+            int length = newline ? (int)(newline - usage) : (int)strlen(usage);
+            const char* help = spec->help ? spec->help : "";
+            const char* help_newline = strchr(help, '\n');
+            int help_length = help_newline ? (int)(help_newline - help) : (int)strlen(help);
+            if (length > HELP_WRAP_WIDTH) {
+                // 写法太长时说明另起一行
+                printf("  %.*s\n%s- %.*s", length, usage, HELP_INDENT, help_length, help);
+            } else {
+                printf("  %-23.*s - %.*s", length, usage, help_length, help);
+            }
+            for (int a = 0; a < MAX_COMMAND_ALIASES && spec->aliases[a]; a++) {
+                printf("%s%s", a == 0 ? " (alias: " : ", ", spec->aliases[a]);
+                if (a + 1 == MAX_COMMAND_ALIASES || !spec->aliases[a + 1]) printf(")");
+            }
+            printf("\n");
+            // 说明的后续行与第一行对齐
+            if (help_newline) print_lines(HELP_INDENT "  ", HELP_INDENT "  ", help_newline + 1);
+            if (newline) print_lines("  ", "  ", newline + 1);
+        }
+    }
+}
+
+// 未知命令：按分组列出所有命令名
+static void print_command_names(void) {
+    printf("Available commands:\n");
+    for (int group = 0; group < COMMAND_GROUP_COUNT; group++) {
+        int printed = 0;
+        for (int i = 0; i < spec_count; i++) {
+            if ((int)specs[i]->group != group) continue;
+            if (printed) {
+                printf(", %s", specs[i]->name);
+            } else {
+                printf("  %s: %s", group_names[group], specs[i]->name);
+            }
+            printed = 1;
+        }
+        if (printed) printf("\n");
+    }
+    printf("Type 'help' for more information\n");
+}
+
+/*
+ * 执行一条命令：查表、检查参数个数，再交给处理函数
+ *
+ * @return 处理函数的返回值（0 成功，-1 失败，-2 退出）；未知命令或参数个数不对返回-1
+ */
+int dispatch_command(ParsedCommand* cmd, const CommandContext* ctx) {
+    if (!cmd || !cmd->command) return -1;
+    const CommandSpec* spec = find_command(cmd->command);
+    if (!spec) {
+        printf("Error: Unknown command '%s'\n", cmd->command);
+        print_command_names();
+        return -1;
+    }
+    int args = cmd->arg_count - 1;
+    if (args < spec->min_args || (spec->max_args != COMMAND_ARGS_UNLIMITED && args > spec->max_args)) {
+        print_command_usage(spec);
+        return -1;
+    }
+    return spec->handler(cmd, ctx);
+}
+
+// 清空命令表（退出时调用）
+void clear_command_table(void) {
+    free(keys);
+    free(specs);
+    keys = NULL;
+    specs = NULL;
+    key_count = key_capacity = spec_count = spec_capacity = 0;
+}
@@ -1,142 +1,510 @@
 #include "../include/commands.h"
+#include "../include/command_table.h"
 #include "../include/process.h"
+#include "../include/disk_image.h"
+#include "../include/exec_cache.h"
+#include "../include/pipeline.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <poll.h>
 
-// 主命令分发函数（控制台指令入口）
-int execute_command(ParsedCommand* cmd, FileSystem* fs, Process* pm) {
-    if (!cmd || !cmd->command) return -1;
-    
-    if (strcmp(cmd->command, "list") == 0) {
-        return execute_list(fs);
-    }
-    // 进程管理相关指令
-    else if (strcmp(cmd->command, "plist") == 0) {
-        // ruby(plist)
-        return execute_plist(pm);
-    }
-    else if (strcmp(cmd->command, "stop") == 0) {
-        // ruby(stop)
-        if (cmd->arg_count < 2) {
-            printf("Usage: stop <process_id>\n");
-            printf("Example: stop 1\n");
-            return -1;
+#define DEFAULT_VIEW_LINES 10    // head / tail 默认行数
+#define DEFAULT_BENCH_RUNS 20     // spawn-bench 每个堆大小的启动次数
+#define DEFAULT_BENCH_MAX_MB 256  // spawn-bench 额外堆内存的上限（MB）
+#define DEFAULT_TOP_INTERVAL_MS 1000 // ptop 的刷新间隔
+#define PLOG_POLL_MS 100          // plog -f 检查新输出的间隔
+
+// 把 args[start..] 用单个空格拼接成一段文本（write / append 的内容参数），按实际长度分配，不截断
+// 返回的文本由调用者 free，内存不足返回 NULL
+static char* join_args(ParsedCommand* cmd, int start) {
+    size_t length = 0;
+    for (int i = start; i < cmd->arg_count; i++) {
+        length += strlen(cmd->args[i]) + (i > start ? 1 : 0);
+    }
+    char* text = (char*)malloc(length + 1);
+    if (!text) return NULL;
+    size_t used = 0;
+    for (int i = start; i < cmd->arg_count; i++) {
+        if (i > start) text[used++] = ' ';
+        size_t n = strlen(cmd->args[i]);
+        memcpy(text + used, cmd->args[i], n);
+        used += n;
+    }
+    text[used] = '\0';
+    return text;
+}
+
+// 解析非负的字节数 / 偏移参数，格式错误返回-1
+static int parse_size_arg(const char* text, size_t* value) {
+    char* endptr;
+    if (!text || *text == '\0' || *text == '-') return -1;
+    unsigned long long parsed = strtoull(text, &endptr, 10);
+    if (*endptr != '\0' || parsed > SIZE_MAX) return -1;
+    *value = (size_t)parsed;
+    return 0;
+}
+
+// 解析资源限制的值：非负整数，bytes=1 时可带 K/M/G 后缀（run --as / --core）
+static int parse_limit_arg(const char* text, int bytes, long long* value) {
+    char* endptr;
+    if (!text || *text < '0' || *text > '9') return -1;
+    unsigned long long parsed = strtoull(text, &endptr, 10);
+    int shift = 0;
+    if (bytes && *endptr != '\0' && endptr[1] == '\0') {
+        shift = *endptr == 'K' || *endptr == 'k' ? 10 :
+                *endptr == 'M' || *endptr == 'm' ? 20 :
+                *endptr == 'G' || *endptr == 'g' ? 30 : -1;
+        endptr++;
+    }
+    if (*endptr != '\0' || shift < 0 || parsed > ((unsigned long long)LLONG_MAX >> shift)) return -1;
+    *value = (long long)(parsed << shift);
+    return 0;
+}
+
+/*
+ * 解析 run 的选项：args[start..end) 为成对的选项，最后一个词为文件名
+ *
+ * @return 格式正确返回0，否则返回-1
+ */
+static int parse_run_options(ParsedCommand* cmd, int start, int end, RunOptions* options) {
+    init_run_options(options);
+    int i = start;
+    for (; i + 1 < end && cmd->args[i][0] == '-'; i += 2) {
+        char* endptr;
+        long value = strtol(cmd->args[i + 1], &endptr, 10);
+        int is_number = *endptr == '\0' && endptr != cmd->args[i + 1];
+        if (strcmp(cmd->args[i], "-p") == 0 && is_number && value >= -MAX_JOB_PRIORITY && value <= MAX_JOB_PRIORITY) {
+            options->priority = (int)value;
+        } else if (strcmp(cmd->args[i], "-n") == 0 && is_number && value >= -20 && value <= 19) {
+            options->limits.nice = (int)value;
+            options->limits.has_nice = 1;
+        } else if (strcmp(cmd->args[i], "-c") == 0 && strlen(cmd->args[i + 1]) < sizeof(options->limits.cpus) &&
+                   validate_cpu_list(cmd->args[i + 1]) == 0) {
+            snprintf(options->limits.cpus, sizeof(options->limits.cpus), "%s", cmd->args[i + 1]);
+        } else {
+            long long* limit = strcmp(cmd->args[i], "--as") == 0 ? &options->limits.address_space :
+                               strcmp(cmd->args[i], "--cpu-time") == 0 ? &options->limits.cpu_seconds :
+                               strcmp(cmd->args[i], "--nofile") == 0 ? &options->limits.open_files :
+                               strcmp(cmd->args[i], "--core") == 0 ? &options->limits.core_size : NULL;
+            int bytes = limit == &options->limits.address_space || limit == &options->limits.core_size;
+            if (!limit || parse_limit_arg(cmd->args[i + 1], bytes, limit) != 0) return -1;
         }
+    }
+    return i == end - 1 ? 0 : -1;
+}
+
+/*
+ * 解析管道：run [options] a [< in] | run [options] b | ... [> out]
+ *
+ * 以 | 分隔各级，第二级起以 run 开头；< 只能出现在第一级、> 只能出现在最后一级，且都在文件名之后
+ *
+ * @return 格式正确返回0，否则返回-1
+ */
+static int parse_pipeline(ParsedCommand* cmd, PipelineStage* stages, int* count,
+                          const char** input_name, const char** output_name) {
+    int start = 1;
+    for (int i = 1; i <= cmd->arg_count; i++) {
+        if (i < cmd->arg_count && strcmp(cmd->args[i], "|") != 0) continue;
+        // args[start..i) 是一级；> 之后不能再有下一级
+        if (*count == PIPELINE_MAX_STAGES || *output_name) return -1;
+        if (*count > 0 && (start >= i || strcmp(cmd->args[start++], "run") != 0)) return -1;
+        int end = i;
+        while (end - start >= 3) {
+            const char* op = cmd->args[end - 2];
+            if (strcmp(op, "<") == 0 && *count == 0 && !*input_name) {
+                *input_name = cmd->args[end - 1];
+            } else if (strcmp(op, ">") == 0 && !*output_name) {
+                *output_name = cmd->args[end - 1];
+            } else {
+                break;
+            }
+            end -= 2;
+        }
+        PipelineStage* stage = &stages[*count];
+        if (parse_run_options(cmd, start, end, &stage->options) != 0) return -1;
+        for (int j = start; j < end; j++) {
+            const char* word = cmd->args[j];
+            if (strcmp(word, "<") == 0 || strcmp(word, ">") == 0) return -1;
+        }
+        stage->name = cmd->args[end - 1];
+        stage->exec_fd = -1;
+        (*count)++;
+        start = i + 1;
+    }
+    return 0;
+}
+
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+// 命令的用法有误：按命令表输出用法
+static int usage_error(ParsedCommand* cmd) {
+    print_command_usage(find_command(cmd->command));
+    return -1;
+}
+
+// 进程管理相关指令
+static int handle_plist(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    // ruby(plist)
+    return execute_plist(ctx->pm);
+}
+
+static int handle_stop(ParsedCommand* cmd, const CommandContext* ctx) {
+    // ruby(stop)
+    if (strcmp(cmd->args[1], "--all") == 0) {
+        if (cmd->arg_count > 2) return usage_error(cmd);
+        return execute_stop_all(ctx->pm);
+    }
+    // 进程号的个数不限
+    int* process_ids = (int*)malloc((size_t)(cmd->arg_count - 1) * sizeof(int));
+    if (!process_ids) {
+        printf("Error: Out of memory\n");
+        return -1;
+    }
+    int process_count = 0;
+    for (int i = 1; i < cmd->arg_count; i++) {
         // 淇：验证进程ID格式（增强错误处理）
         char* endptr;
-        long process_id_long = strtol(cmd->args[1], &endptr, 10);
+        long process_id_long = strtol(cmd->args[i], &endptr, 10);
         // 淇：检查转换是否成功，以及值是否在有效范围内
         if (*endptr != '\0' || process_id_long <= 0 || process_id_long > INT_MAX) {
             printf("Error: Invalid process ID '%s'. Process ID must be a positive integer (1-%d).\n", 
-                   cmd->args[1], INT_MAX);
+                   cmd->args[i], INT_MAX);
             printf("Use 'plist' to see running processes and their IDs.\n");
+            free(process_ids);
             return -1;
         }
-        int process_id = (int)process_id_long;
-        return execute_stop(pm, process_id);
+        process_ids[process_count++] = (int)process_id_long;
     }
-    else if (strcmp(cmd->command, "run") == 0) {
-        // ruby(run)
-        if (cmd->arg_count < 2) {
-            printf("Usage: run <filename>\n");
-            return -1;
+    int result = execute_stop(ctx->pm, process_ids, process_count);
+    free(process_ids);
+    return result;
+}
+
+static int handle_run(ParsedCommand* cmd, const CommandContext* ctx) {
+    // ruby(run)：选项在文件名之前，-p 优先级（排队时使用）、-n nice 值、-c CPU 列表，
+    // --as / --cpu-time / --nofile / --core 为子进程的资源限制；含 | < > 时按管道处理
+    for (int i = 1; i < cmd->arg_count; i++) {
+        if (strcmp(cmd->args[i], "|") == 0 || strcmp(cmd->args[i], "<") == 0 || strcmp(cmd->args[i], ">") == 0) {
+            PipelineStage stages[PIPELINE_MAX_STAGES];
+            int count = 0;
+            const char* input_name = NULL;
+            const char* output_name = NULL;
+            if (parse_pipeline(cmd, stages, &count, &input_name, &output_name) != 0) {
+                return usage_error(cmd);
+            }
+            return execute_pipeline(ctx->fs, stages, count, input_name, output_name);
         }
-        return execute_run(fs, pm, cmd->args[1]);
     }
+    RunOptions options;
+    if (parse_run_options(cmd, 1, cmd->arg_count, &options) != 0) {
+        return usage_error(cmd);
+    }
+    return execute_run(ctx->fs, ctx->pm, cmd->args[cmd->arg_count - 1], &options);
+}
 
-    // 文件系统 / 目录相关指令（顺序与 execute_* / file_system 保持一致）
-    else if (strcmp(cmd->command, "copy") == 0) {
-        if (cmd->arg_count < 3) {
-            printf("Usage: copy <src_filename> <dest_filename>\n");
-            return -1;
-        }
-        return execute_copy(fs, cmd->args[1], cmd->args[2]);
+static int handle_jobs(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)ctx;
+    // ruby(jobs)
+    if (cmd->arg_count == 1) {
+        return execute_jobs(0);
     }
-    else if (strcmp(cmd->command, "rename") == 0) {
-        if (cmd->arg_count < 3) {
-            printf("Usage: rename <old_filename> <new_filename>\n");
-            return -1;
-        }
-        return execute_rename(fs, cmd->args[1], cmd->args[2]);
+    char* endptr = NULL;
+    long job_id = cmd->arg_count == 3 ? strtol(cmd->args[2], &endptr, 10) : 0;
+    if (cmd->arg_count != 3 || strcmp(cmd->args[1], "--cancel") != 0 || *endptr != '\0' ||
+        job_id <= 0 || job_id > INT_MAX) {
+        return usage_error(cmd);
     }
-    else if (strcmp(cmd->command, "list") == 0) {
-        return execute_list(fs);
+    return execute_jobs((int)job_id);
+}
+
+static int handle_plog(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)ctx;
+    char* endptr = NULL;
+    long process_id = strtol(cmd->args[1], &endptr, 10);
+    int follow = cmd->arg_count == 3 && strcmp(cmd->args[2], "-f") == 0;
+    if (*endptr != '\0' || process_id <= 0 || process_id > INT_MAX || (cmd->arg_count == 3 && !follow)) {
+        return usage_error(cmd);
     }
-    else if (strcmp(cmd->command, "view") == 0) {
-        if (cmd->arg_count < 2) {
-            printf("Usage: view <filename>\n");
-            return -1;
+    return execute_plog((int)process_id, follow);
+}
+
+static int handle_ptop(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)ctx;
+    int sort_by_memory = 0;
+    size_t interval_ms = DEFAULT_TOP_INTERVAL_MS;
+    size_t frames = 0;
+    for (int i = 1; i < cmd->arg_count; i++) {
+        if (strcmp(cmd->args[i], "-m") == 0) {
+            sort_by_memory = 1;
+            continue;
         }
-        return execute_view(fs, cmd->args[1]);
-    }
-    else if (strcmp(cmd->command, "delete") == 0) {
-        if (cmd->arg_count < 2) {
-            printf("Usage: delete <filename>\n");
-            return -1;
+        size_t* value = strcmp(cmd->args[i], "-d") == 0 ? &interval_ms :
+                        strcmp(cmd->args[i], "-n") == 0 ? &frames : NULL;
+        if (!value || i + 1 >= cmd->arg_count || parse_size_arg(cmd->args[i + 1], value) != 0 ||
+            *value > INT_MAX || (value == &interval_ms && interval_ms == 0)) {
+            return usage_error(cmd);
         }
-        return execute_delete(fs, cmd->args[1]);
+        i++;
     }
-    else if (strcmp(cmd->command, "mkdir") == 0) {
-        if (cmd->arg_count < 2) {
-            printf("Usage: mkdir <directory>\n");
-            return -1;
-        }
-        return execute_mkdir(fs, cmd->args[1]);
+    return execute_ptop(sort_by_memory, (int)interval_ms, (int)frames);
+}
+
+static int handle_cache_stats(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    (void)ctx;
+    return execute_cache_stats();
+}
+
+static int handle_spawn_bench(ParsedCommand* cmd, const CommandContext* ctx) {
+    size_t runs = DEFAULT_BENCH_RUNS;
+    size_t max_mb = DEFAULT_BENCH_MAX_MB;
+    if ((cmd->arg_count > 2 && (parse_size_arg(cmd->args[2], &runs) != 0 || runs == 0 || runs > INT_MAX)) ||
+        (cmd->arg_count > 3 && parse_size_arg(cmd->args[3], &max_mb) != 0)) {
+        return usage_error(cmd);
     }
-    else if (strcmp(cmd->command, "cd") == 0) {
-        if (cmd->arg_count < 2) {
-            printf("Usage: cd <directory>\n");
-            return -1;
+    return execute_spawn_bench(ctx->fs, cmd->args[1], (int)runs, max_mb);
+}
+
+// 文件系统 / 目录相关指令（顺序与 execute_* / file_system 保持一致）
+static int handle_copy(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_copy(ctx->fs, cmd->args[1], cmd->args[2]);
+}
+
+static int handle_rename(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_rename(ctx->fs, cmd->args[1], cmd->args[2]);
+}
+
+static int handle_list(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    return execute_list(ctx->fs);
+}
+
+static int handle_view(ParsedCommand* cmd, const CommandContext* ctx) {
+    size_t offset = 0;
+    size_t length = SIZE_MAX;
+    for (int i = 2; i < cmd->arg_count; i++) {
+        size_t* value = strcmp(cmd->args[i], "--offset") == 0 ? &offset :
+                        strcmp(cmd->args[i], "--length") == 0 ? &length : NULL;
+        if (!value || i + 1 >= cmd->arg_count || parse_size_arg(cmd->args[i + 1], value) != 0) {
+            return usage_error(cmd);
         }
-        return execute_cd(fs, cmd->args[1]);
-    }
-    // 系统控制和帮助类指令
-    else if (strcmp(cmd->command, "exit") == 0) {
-        return -2; // 淇：特殊返回值，表示退出
-    }
-    else if (strcmp(cmd->command, "help") == 0) {
-        printf("NeuMiniOS Command Reference:\n");
-        printf("===========================\n\n");
-        printf("File Operations:\n");
-        printf("  list                    - List all files in current directory\n");
-        printf("  view <filename>         - Display file contents\n");
-        printf("  delete <filename>       - Delete a file\n");
-        printf("  copy <src> <dest>       - Copy a file\n");
-        printf("  rename <old> <new>      - Rename a file\n\n");
-        printf("Process Operations:\n");
-        printf("  plist                   - List all running processes\n");
-        printf("  stop <pid>              - Stop a running process\n");
-        printf("  run <filename>          - Run an executable file\n\n");
-        printf("Directory Operations (bonus):\n");
-        printf("  cd <directory>          - Change directory\n");
-        printf("  mkdir <directory>      - Create directory\n\n");
-        printf("System:\n");
-        printf("  exit                    - Exit NeuMiniOS\n");
-        printf("  help                    - Show this help message\n\n");
-        printf("Command History (bonus):\n");
-        printf("  !!                      - Execute previous command\n");
-        return 0;
+        i++;
     }
-    else if (strcmp(cmd->command, "history") == 0) {
-        // 淇：加分项：显示命令历史
-        // 淇：注意：实际的历史查看需要通过CLI接口
-        printf("Use arrow keys (up/down) to navigate command history\n");
-        printf("Note: History navigation requires terminal support\n");
-        return 0;
+    if (offset == 0 && length == SIZE_MAX) {
+        return execute_view(ctx->fs, cmd->args[1]);
+    }
+    return view_file_range(ctx->fs, cmd->args[1], offset, length);
+}
+
+// head / tail 共用，按登记的命令名区分
+static int handle_head_tail(ParsedCommand* cmd, const CommandContext* ctx) {
+    size_t lines = DEFAULT_VIEW_LINES;
+    if (cmd->arg_count > 2 && parse_size_arg(cmd->args[2], &lines) != 0) {
+        return usage_error(cmd);
     }
-    else {
-        printf("Error: Unknown command '%s'\n", cmd->command);
-        printf("Available commands:\n");
-        printf("  File operations: list, view, delete, copy, rename\n");
-        printf("  Process operations: plist, stop, run\n");
-        printf("  Directory operations: cd, mkdir (bonus)\n");
-        printf("  System: exit\n");
-        printf("Type 'help' for more information\n");
+    int from_end = strcmp(find_command(cmd->command)->name, "tail") == 0;
+    return execute_head_tail(ctx->fs, cmd->args[1], lines, from_end);
+}
+
+static int handle_more(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_more(ctx->fs, cmd->args[1]);
+}
+
+static int handle_write(ParsedCommand* cmd, const CommandContext* ctx) {
+    size_t offset;
+    if (parse_size_arg(cmd->args[2], &offset) != 0) {
+        return usage_error(cmd);
+    }
+    char* text = join_args(cmd, 3);
+    if (!text) {
+        printf("Error: Out of memory\n");
+        return -1;
+    }
+    int result = execute_write(ctx->fs, cmd->args[1], offset, text);
+    free(text);
+    return result;
+}
+
+static int handle_append(ParsedCommand* cmd, const CommandContext* ctx) {
+    char* text = join_args(cmd, 2);
+    if (!text) {
+        printf("Error: Out of memory\n");
         return -1;
     }
+    int result = execute_append(ctx->fs, cmd->args[1], text);
+    free(text);
+    return result;
+}
+
+static int handle_truncate(ParsedCommand* cmd, const CommandContext* ctx) {
+    size_t size;
+    if (parse_size_arg(cmd->args[2], &size) != 0) {
+        return usage_error(cmd);
+    }
+    return execute_truncate(ctx->fs, cmd->args[1], size);
+}
+
+static int handle_delete(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_delete(ctx->fs, cmd->args[1]);
+}
+
+static int handle_mkdir(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_mkdir(ctx->fs, cmd->args[1]);
+}
+
+static int handle_cd(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_cd(ctx->fs, cmd->args[1]);
+}
+
+// 磁盘镜像相关指令
+static int handle_save_image(ParsedCommand* cmd, const CommandContext* ctx) {
+    return execute_save_image(ctx->fs, cmd->args[1]);
+}
+
+static int handle_df(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    return execute_df(ctx->fs);
+}
+
+static int handle_dedup_stats(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    return execute_dedup_stats(ctx->fs);
+}
+
+// 系统控制和帮助类指令
+static int handle_exit(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    (void)ctx;
+    return -2; // 淇：特殊返回值，表示退出
+}
+
+static int handle_help(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)ctx;
+    if (cmd->arg_count == 2) {
+        // help <command>：只显示这条命令的说明和用法
+        const CommandSpec* spec = find_command(cmd->args[1]);
+        if (!spec) {
+            printf("Error: Unknown command '%s'\n", cmd->args[1]);
+            return -1;
+        }
+        printf("%s:\n", spec->name);
+        if (spec->help) {
+            // 多行说明逐行缩进输出
+            for (const char* line = spec->help; line; ) {
+                const char* newline = strchr(line, '\n');
+                printf("  %.*s\n", newline ? (int)(newline - line) : (int)strlen(line), line);
+                line = newline ? newline + 1 : NULL;
+            }
+        }
+        print_command_usage(spec);
+        return 0;
+    }
+    print_command_help();
+    printf("\nCommand History (bonus):\n");
+    printf("  !!                      - Execute previous command\n");
+    return 0;
+}
+
+static int handle_history(ParsedCommand* cmd, const CommandContext* ctx) {
+    (void)cmd;
+    (void)ctx;
+    // 淇：加分项：显示命令历史
+    // 淇：注意：实际的历史查看需要通过CLI接口
+    printf("Use arrow keys (up/down) to navigate command history\n");
+    printf("Note: History navigation requires terminal support\n");
+    return 0;
+}
+
+// 内置命令（help 按分组、按这里的顺序输出）
+static const CommandSpec builtin_commands[] = {
+    // 文件管理
+    {"list", {"ls"}, 0, 0, COMMAND_GROUP_FILE, "list", NULL,
+     "List all files in current directory", handle_list},
+    {"view", {NULL}, 1, 5, COMMAND_GROUP_FILE, "view <filename> [--offset N] [--length M]", NULL,
+     "Display file contents, or the part selected by --offset / --length", handle_view},
+    {"head", {NULL}, 1, 2, COMMAND_GROUP_FILE, "head <filename> [lines]", NULL,
+     "Display the first n lines (default " TO_STRING(DEFAULT_VIEW_LINES) ")", handle_head_tail},
+    {"tail", {NULL}, 1, 2, COMMAND_GROUP_FILE, "tail <filename> [lines]", NULL,
+     "Display the last n lines (default " TO_STRING(DEFAULT_VIEW_LINES) ")", handle_head_tail},
+    {"more", {NULL}, 1, 1, COMMAND_GROUP_FILE, "more <filename>", NULL,
+     "Page through a file (space: next page, enter: next line, q: quit)", handle_more},
+    {"delete", {"rm"}, 1, 1, COMMAND_GROUP_FILE, "delete <filename>", NULL,
+     "Delete a file", handle_delete},
+    {"copy", {"cp"}, 2, 2, COMMAND_GROUP_FILE, "copy <src_filename> <dest_filename>", NULL,
+     "Copy a file", handle_copy},
+    {"rename", {"mv"}, 2, 2, COMMAND_GROUP_FILE, "rename <old_filename> <new_filename>", NULL,
+     "Rename a file", handle_rename},
+    {"write", {NULL}, 3, COMMAND_ARGS_UNLIMITED, COMMAND_GROUP_FILE, "write <filename> <offset> <text>", NULL,
+     "Overwrite text at a byte offset (creates the file)", handle_write},
+    {"append", {NULL}, 2, COMMAND_ARGS_UNLIMITED, COMMAND_GROUP_FILE, "append <filename> <text>", NULL,
+     "Append a line of text (creates the file)", handle_append},
+    {"truncate", {NULL}, 2, 2, COMMAND_GROUP_FILE, "truncate <filename> <size>", NULL,
+     "Shrink or zero-extend a file", handle_truncate},
+    // 进程管理
+    {"plist", {NULL}, 0, 0, COMMAND_GROUP_PROCESS, "plist", NULL,
+     "List processes with CPU time, memory, context switches and limits", handle_plist},
+    {"stop", {NULL}, 1, COMMAND_ARGS_UNLIMITED, COMMAND_GROUP_PROCESS,
+     "stop <process_id> [process_id...]\nstop --all", "stop 1",
+     "Stop processes (SIGTERM, SIGKILL after the grace period; returns at once,\n"
+     "results are shown before the next prompt); --all also cancels queued jobs", handle_stop},
+    {"run", {NULL}, 1, COMMAND_ARGS_UNLIMITED, COMMAND_GROUP_PROCESS,
+     "run [-p priority] [-n nice] [-c cpus] [--as size] [--cpu-time sec] [--nofile n] [--core size] <filename>\n"
+     "run [options] <file> [< input] | run [options] <file> ... [> output]",
+     "run -p 5 -n 10 -c 0-1 helloworld\n"
+     "run --as 256M --cpu-time 10 --core 0 helloworld\n"
+     "run generator | run filter < datafile.txt > out.txt",
+     "Run an executable file (queued when the concurrency limit is reached,\n"
+     "higher priority starts first); --as / --cpu-time / --nofile / --core set\n"
+     "resource limits; | connects programs, < feeds a file, > saves the output", handle_run},
+    {"jobs", {NULL}, 0, 2, COMMAND_GROUP_PROCESS, "jobs [--cancel <job_id>]", NULL,
+     "List queued jobs and running processes, or cancel a queued job", handle_jobs},
+    {"plog", {NULL}, 1, 2, COMMAND_GROUP_PROCESS, "plog <pid> [-f]", NULL,
+     "Show captured output (boot with --capture), -f follows it", handle_plog},
+    {"ptop", {NULL}, 0, 5, COMMAND_GROUP_PROCESS, "ptop [-m] [-d interval_ms] [-n frames]", NULL,
+     "Live per-process CPU / memory view (q to quit, -m sorts by RSS)", handle_ptop},
+    {"cache-stats", {NULL}, 0, 0, COMMAND_GROUP_PROCESS, "cache-stats", NULL,
+     "Show executable cache hits / misses", handle_cache_stats},
+    {"spawn-bench", {NULL}, 1, 3, COMMAND_GROUP_PROCESS, "spawn-bench <filename> [runs] [max_mb]", NULL,
+     "Compare fork / posix_spawn launch latency vs heap size", handle_spawn_bench},
+    // 目录（加分项）
+    {"cd", {NULL}, 1, 1, COMMAND_GROUP_DIRECTORY, "cd <directory>", NULL,
+     "Change directory", handle_cd},
+    {"mkdir", {NULL}, 1, 1, COMMAND_GROUP_DIRECTORY, "mkdir <directory>", NULL,
+     "Create directory", handle_mkdir},
+    // 磁盘镜像
+    {"save-image", {NULL}, 1, 1, COMMAND_GROUP_IMAGE, "save-image <host_path>", NULL,
+     "Save the disk image to a host file (boot with --image)", handle_save_image},
+    {"df", {NULL}, 0, 0, COMMAND_GROUP_IMAGE, "df", NULL,
+     "Show logical / physical / resident disk image size", handle_df},
+    {"dedup-stats", {NULL}, 0, 0, COMMAND_GROUP_IMAGE, "dedup-stats", NULL,
+     "Show block store deduplication savings", handle_dedup_stats},
+    // 系统
+    {"exit", {"quit"}, 0, 0, COMMAND_GROUP_SYSTEM, "exit", NULL,
+     "Exit NeuMiniOS", handle_exit},
+    {"help", {NULL}, 0, 1, COMMAND_GROUP_SYSTEM, "help [command]", NULL,
+     "Show this help message, or the usage of one command", handle_help},
+    {"history", {NULL}, 0, 0, COMMAND_GROUP_SYSTEM, "history", NULL,
+     "Show how to navigate the command history", handle_history},
+};
+
+// 登记内置命令（引导时调用一次），返回登记失败的条数
+int register_builtin_commands(void) {
+    return register_commands(builtin_commands, (int)(sizeof(builtin_commands) / sizeof(builtin_commands[0])));
+}
+
+// 主命令分发函数（控制台指令入口）：按命令表查找并执行
+int execute_command(ParsedCommand* cmd, FileSystem* fs, Process* pm) {
+    CommandContext ctx = {fs, pm};
+    return dispatch_command(cmd, &ctx);
 }
 
 
@@ -153,44 +521,356 @@ int execute_plist(Process* pm) {
     return 0;
 }
 
-// 淇：执行 stop 命令
-int execute_stop(Process* pm, int process_id) {
+// 淇：执行 stop 命令（多个 PID 同时发信号，不等待退出）
+int execute_stop(Process* pm, const int* process_ids, int count) {
     (void)pm;  // 淇：不再需要pm参数，但保持接口兼容
     
-    if (process_id <= 0) {
-        printf("Error: Invalid process ID. Process ID must be a positive integer.\n");
-        return -1;
+    for (int i = 0; i < count; i++) {
+        if (process_ids[i] <= 0) {
+            printf("Error: Invalid process ID. Process ID must be a positive integer.\n");
+            return -1;
+        }
     }
     
-    return stop_process(process_id);
+    if (count == 1) {
+        return stop_process(process_ids[0]);
+    }
+    return stop_processes(process_ids, count);
+}
+
+// 执行 stop --all
+int execute_stop_all(Process* pm) {
+    (void)pm;
+    return stop_all_processes();
+}
+
+/*
+ * 为 run 准备可执行的 fd：按内容哈希查 exec 缓存，未命中时把内容写进封印的匿名内存文件并放入缓存
+ *
+ * @param cached  返回 1 表示 fd 归缓存所有（调用者不要关闭），0 表示调用者用完后关闭
+ *
+ * @return 可执行的 fd；准备失败返回 -1（已打印错误）；内核不支持 memfd 返回 -2
+ */
+static int prepare_exec_fd(FileSystem* fs, FileNode* file, int* cached) {
+    // 内容相同的程序已经准备好时直接执行，暖缓存下只剩 fork + exec
+    uint64_t hash = 0;
+    int hashed = file_content_hash(fs, file, &hash) == 0;
+    int exec_fd = hashed ? exec_cache_lookup(hash, file->size) : -1;
+    if (exec_fd >= 0) {
+        *cached = 1;
+        return exec_fd;
+    }
+
+    // 文件内容只复制一次：写进封印的匿名内存文件，通过 fd 执行，不产生磁盘写入
+    exec_fd = create_exec_memfd(file->filename);
+    if (exec_fd < 0) return -2;
+    if (write_file_to_fd(fs, file, exec_fd) != 0 || seal_exec_memfd(exec_fd) != 0) {
+        printf("Error: Failed to prepare '%s' for execution\n", file->filename);
+        close(exec_fd);
+        return -1;
+    }
+    // 准备好的 memfd 留给下一次 run；缓存放不下时由调用者关闭
+    *cached = hashed && exec_cache_insert(hash, file->size, exec_fd) == 0;
+    return exec_fd;
 }
 
-// ruby(run)：CLI -> 进程管理：先从磁盘镜像解包文件，再交给进程模块创建并运行进程
+// ruby(run)：CLI -> 进程管理：先准备好可执行的 fd（exec 缓存 / memfd），再交给进程模块创建并运行进程
 // 执行 run 命令
-int execute_run(FileSystem* fs, Process* pm, const char* filename) {
+// 达到并发上限时进程模块把作业排队，返回0
+int execute_run(FileSystem* fs, Process* pm, const char* filename, const RunOptions* options) {
     (void)pm;  // 不再需要pm参数，但保持接口兼容
     
     if (!fs || !filename) {
-        printf("Usage: run <filename>\n");
+        printf("Usage: run [-p priority] [-n nice] [-c cpus] <filename>\n");
         return -1;
     }
     
-    // 提取文件到临时位置
-    char temp_path[256];
-    snprintf(temp_path, sizeof(temp_path), "/tmp/neuminios_%s_%d", filename, getpid());
-    
-    if (extract_file_to_host(fs, filename, temp_path) != 0) {
-        printf("Error: Failed to extract file '%s'\n", filename);
+    FileNode* file = find_file(fs, filename);
+    if (!file || file->is_directory) {
+        printf("Error: File '%s' not found\n", filename);
         return -1;
     }
-    
-    // 使用新的create_process函数，它会处理文件读取、临时文件创建和进程启动
-    int process_id = create_process(filename, temp_path);
-    if (process_id > 0) {
-        return 0;
+
+    // 子进程与 NeuMiniOS 共用标准输出：批处理模式下输出到管道时是全缓冲的，先写出之前的内容以保持顺序
+    fflush(stdout);
+    int process_id = -1;
+    int cached = 0;
+    int exec_fd = prepare_exec_fd(fs, file, &cached);
+    if (exec_fd >= 0) {
+        process_id = create_process_from_fd(filename, exec_fd, options);
+        if (!cached) close(exec_fd);
+    } else if (exec_fd == -1) {
+        return -1;
     } else {
+        // 不支持 memfd 的内核：退回到一个临时文件，进程 exec 完成后立即删除
+        char temp_path[] = "/tmp/neuminios_XXXXXX";
+        int fd = mkstemp(temp_path);
+        if (fd < 0) {
+            printf("Error: Failed to extract file '%s'\n", filename);
+            return -1;
+        }
+        int ok = write_file_to_fd(fs, file, fd) == 0 && fchmod(fd, S_IRWXU) == 0;
+        if (close(fd) != 0) ok = 0;
+        if (ok) {
+            process_id = create_process(filename, temp_path, options);
+        } else {
+            printf("Error: Failed to extract file '%s'\n", filename);
+        }
+        unlink(temp_path);
+    }
+    return process_id >= 0 ? 0 : -1;
+}
+
+// jobs：列出排队的作业和运行中的进程；cancel_id > 0 时取消这个排队的作业
+int execute_jobs(int cancel_id) {
+    if (cancel_id > 0) {
+        return cancel_job(cancel_id);
+    }
+    list_jobs();
+    return 0;
+}
+
+/*
+ * 管道：准备好各级的可执行 fd，连接 < / > 的管道后一起启动，再在前台搬运输入输出
+ *
+ * 没有 < / > 时各级启动后立即返回，与 run 相同；有重定向时等到输出结束（或按 q）才返回。
+ * 管道不进入运行队列，空闲名额不够时报错。
+ */
+int execute_pipeline(FileSystem* fs, PipelineStage* stages, int count, const char* input_name, const char* output_name) {
+    if (!fs || !stages || count <= 0) return -1;
+
+    FileNode* input = input_name ? find_file(fs, input_name) : NULL;
+    if (input_name && (!input || input->is_directory)) {
+        printf("Error: File '%s' not found\n", input_name);
         return -1;
     }
+    FileNode* existing = output_name ? find_file(fs, output_name) : NULL;
+    if (existing && existing->is_directory) {
+        printf("Error: '%s' is a directory\n", output_name);
+        return -1;
+    }
+
+    int cached[PIPELINE_MAX_STAGES] = {0};
+    int prepared = 0;
+    int input_pipe[2] = {-1, -1};
+    int output_pipe[2] = {-1, -1};
+    int sink_fd = -1;
+    int result = -1;
+    for (; prepared < count; prepared++) {
+        FileNode* file = find_file(fs, stages[prepared].name);
+        if (!file || file->is_directory) {
+            printf("Error: File '%s' not found\n", stages[prepared].name);
+            goto done;
+        }
+        int exec_fd = prepare_exec_fd(fs, file, &cached[prepared]);
+        if (exec_fd == -2) printf("Error: Pipelines need memfd support from the kernel\n");
+        if (exec_fd < 0) goto done;
+        stages[prepared].exec_fd = exec_fd;
+    }
+
+    if (input && open_pipeline_pipe(input_pipe) != 0) {
+        printf("Error: Cannot create pipe for '%s'\n", input_name);
+        goto done;
+    }
+    if (output_name) {
+        sink_fd = create_pipeline_sink();
+        if (sink_fd < 0 || open_pipeline_pipe(output_pipe) != 0) {
+            printf("Error: Cannot capture output for '%s'\n", output_name);
+            goto done;
+        }
+    }
+
+    // 子进程一端交给管道的各级后立即关闭，否则读写两端都收不到 EOF
+    fflush(stdout);
+    result = create_pipeline(stages, count, input_pipe[0], output_pipe[1]);
+    if (input_pipe[0] >= 0) close(input_pipe[0]);
+    if (output_pipe[1] >= 0) close(output_pipe[1]);
+    input_pipe[0] = output_pipe[1] = -1;
+    if (result != 0 || (!input && !output_name)) {
+        // 启动失败时关闭 NeuMiniOS 一端，已启动的级读到 EOF / 写入断开的管道后退出
+        goto done;
+    }
+
+    uint64_t collected = 0;
+    int pumped = pump_pipeline(fs, input, input_pipe[1], output_pipe[0], sink_fd, &collected);
+    input_pipe[1] = output_pipe[0] = -1;   // 已由 pump_pipeline 关闭
+    if (pumped == 2) {
+        printf("[INFO] The first stage stopped reading before the end of '%s'\n", input_name);
+    }
+    if (pumped < 0) {
+        result = -1;
+    } else if (output_name) {
+        if (store_pipeline_output(fs, output_name, sink_fd, collected) != 0) {
+            printf("Error: Failed to save pipeline output to '%s'\n", output_name);
+            result = -1;
+        } else if (pumped == 1) {
+            printf("[INFO] Stopped waiting for the pipeline, kept %llu bytes in '%s'\n",
+                   (unsigned long long)collected, output_name);
+        } else {
+            printf("[OK] Wrote %llu bytes to '%s'\n", (unsigned long long)collected, output_name);
+        }
+    } else if (pumped == 1) {
+        printf("[INFO] Stopped feeding '%s' to the pipeline\n", input_name);
+    } else if (pumped == 0) {
+        printf("[OK] Fed %zu bytes from '%s' to the pipeline\n", input->size, input_name);
+    }
+
+done:
+    for (int i = 0; i < 2; i++) {
+        if (input_pipe[i] >= 0) close(input_pipe[i]);
+        if (output_pipe[i] >= 0) close(output_pipe[i]);
+    }
+    if (sink_fd >= 0) close(sink_fd);
+    for (int i = 0; i < prepared; i++) {
+        if (!cached[i]) close(stages[i].exec_fd);
+    }
+    return result;
+}
+
+/*
+ * plog：输出进程捕获的输出；follow=1 时持续输出新内容，直到按 q 或进程退出
+ * 读取位置落后超过缓冲区容量时，被覆盖的部分以一行提示代替
+ */
+int execute_plog(int pid, int follow) {
+    int interactive = follow && isatty(STDIN_FILENO);
+    struct termios oldt, newt;
+    if (interactive && tcgetattr(STDIN_FILENO, &oldt) == 0) {
+        newt = oldt;
+        newt.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+    } else {
+        interactive = 0;
+    }
+
+    char buffer[4096];
+    uint64_t position = 0;
+    char last = '\n';
+    int skip_partial = 0;
+    int result = 0;
+    while (1) {
+        uint64_t dropped = 0;
+        int running = 0;
+        ssize_t n = read_process_output(pid, &position, buffer, sizeof(buffer), &dropped, &running);
+        if (n == -1) {
+            // 跟随期间退出记录被后来的进程挤掉时直接结束
+            if (position == 0) {
+                printf("Error: Process %d not found\n", pid);
+                result = -1;
+            }
+            break;
+        }
+        if (n == -2) {
+            printf("Error: Output of process %d is not captured (boot with --capture)\n", pid);
+            result = -1;
+            break;
+        }
+        if (dropped > 0) {
+            printf("%s[... %llu bytes dropped ...]\n", last == '\n' ? "" : "\n", (unsigned long long)dropped);
+            last = '\n';
+            skip_partial = 1;
+        }
+        if (n > 0) {
+            // 丢弃之后的第一行不完整，从下一行开始输出
+            const char* start = buffer;
+            if (skip_partial) {
+                const char* newline = memchr(buffer, '\n', (size_t)n);
+                start = newline ? newline + 1 : buffer + n;
+                skip_partial = newline == NULL;
+            }
+            if (start < buffer + n) {
+                fwrite(start, 1, (size_t)(buffer + n - start), stdout);
+                last = buffer[n - 1];
+            }
+            continue;
+        }
+
+        // 已经读到最新
+        if (!follow || !running) break;
+        fflush(stdout);
+        struct pollfd key = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&key, interactive ? 1 : 0, PLOG_POLL_MS) > 0) {
+            char ch;
+            if (read(STDIN_FILENO, &ch, 1) <= 0 || ch == 'q' || ch == 'Q') break;
+        }
+    }
+
+    if (last != '\n') printf("\n");
+    if (interactive) tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+    return result;
+}
+
+/*
+ * ptop：每 interval_ms 毫秒清屏刷新一次进程资源使用，按 q 退出
+ *
+ * @param frames  刷新次数，0 表示直到按 q（标准输入不是终端时只输出一帧）
+ */
+int execute_ptop(int sort_by_memory, int interval_ms, int frames) {
+    int interactive = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+    if (!interactive && frames == 0) frames = 1;
+
+    // 关闭规范模式和回显，按 q 立即退出
+    struct termios oldt, newt;
+    if (interactive && tcgetattr(STDIN_FILENO, &oldt) == 0) {
+        newt = oldt;
+        newt.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+    } else {
+        interactive = 0;
+    }
+
+    int result = 0;
+    for (int frame = 0; frames == 0 || frame < frames; frame++) {
+        if (interactive) printf("\033[H\033[2J");
+        printf("=== ptop (refresh %d ms%s) ===\n", interval_ms, interactive ? ", q to quit" : "");
+        if (print_process_top(sort_by_memory) < 0) {
+            printf("Error: Out of memory\n");
+            result = -1;
+            break;
+        }
+        fflush(stdout);
+        if (frames != 0 && frame + 1 >= frames) break;
+
+        // 等待下一次刷新；交互模式下同时等待按键
+        struct pollfd key = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&key, interactive ? 1 : 0, interval_ms) > 0) {
+            char ch;
+            if (read(STDIN_FILENO, &ch, 1) <= 0 || ch == 'q' || ch == 'Q') break;
+        }
+    }
+
+    if (interactive) tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+    reset_process_top();
+    return result;
+}
+
+// spawn-bench <filename> [runs] [max_mb]
+int execute_spawn_bench(FileSystem* fs, const char* filename, int runs, size_t max_mb) {
+    if (!fs || !filename || runs <= 0) {
+        printf("Usage: spawn-bench <filename> [runs] [max_mb]\n");
+        return -1;
+    }
+
+    FileNode* file = find_file(fs, filename);
+    if (!file || file->is_directory) {
+        printf("Error: File '%s' not found\n", filename);
+        return -1;
+    }
+
+    int cached = 0;
+    int exec_fd = prepare_exec_fd(fs, file, &cached);
+    if (exec_fd < 0) {
+        if (exec_fd == -2) printf("Error: spawn-bench requires memfd support\n");
+        return -1;
+    }
+    int result = benchmark_spawn(filename, exec_fd, runs, max_mb);
+    if (!cached) close(exec_fd);
+    return result;
+}
+
+// cache-stats
+int execute_cache_stats(void) {
+    print_exec_cache_stats();
+    return 0;
 }
 
 // =========================
@@ -247,6 +927,165 @@ int execute_view(FileSystem* fs, const char* filename) {
     return view_file(fs, filename);
 }
 
+// write <filename> <offset> <text>
+int execute_write(FileSystem* fs, const char* filename, size_t offset, const char* text) {
+    if (!fs || !filename || !text) {
+        printf("Usage: write <filename> <offset> <text>\n");
+        return -1;
+    }
+
+    if (write_to_file(fs, filename, offset, text, strlen(text)) == 0) {
+        printf("Wrote %zu bytes to '%s' at offset %zu\n", strlen(text), filename, offset);
+        return 0;
+    } else {
+        printf("Error: Failed to write to '%s'\n", filename);
+        return -1;
+    }
+}
+
+// append <filename> <text>（按行追加，自动补换行）
+int execute_append(FileSystem* fs, const char* filename, const char* text) {
+    if (!fs || !filename || !text) {
+        printf("Usage: append <filename> <text>\n");
+        return -1;
+    }
+
+    size_t length = strlen(text);
+    if (append_to_file(fs, filename, text, length) == 0 &&
+        append_to_file(fs, filename, "\n", 1) == 0) {
+        printf("Appended %zu bytes to '%s'\n", length + 1, filename);
+        return 0;
+    } else {
+        printf("Error: Failed to append to '%s'\n", filename);
+        return -1;
+    }
+}
+
+// truncate <filename> <size>
+int execute_truncate(FileSystem* fs, const char* filename, size_t size) {
+    if (!fs || !filename) {
+        printf("Usage: truncate <filename> <size>\n");
+        return -1;
+    }
+
+    if (truncate_file(fs, filename, size) == 0) {
+        printf("File '%s' truncated to %zu bytes\n", filename, size);
+        return 0;
+    } else {
+        printf("Error: Failed to truncate '%s'\n", filename);
+        return -1;
+    }
+}
+
+// head <filename> [lines] / tail <filename> [lines]
+int execute_head_tail(FileSystem* fs, const char* filename, size_t lines, bool from_end) {
+    if (!fs || !filename) {
+        printf("Usage: %s <filename> [lines]\n", from_end ? "tail" : "head");
+        return -1;
+    }
+    return view_file_lines(fs, filename, lines, from_end);
+}
+
+// 分页器状态
+typedef struct {
+    int page_lines;            // 每页行数
+    int lines_left;            // 本页还能输出的行数
+    size_t shown;              // 已输出的字节数（用于显示百分比）
+    size_t total;              // 文件大小
+    int quit;                  // 用户按了 q
+    char last;                 // 最后输出的字符（结尾不是换行时补一个）
+} PagerState;
+
+// 等待一个按键：空格翻一页，回车多显示一行，q 退出
+static void pager_prompt(PagerState* pager) {
+    char prompt[64];
+    int n = snprintf(prompt, sizeof(prompt), "--More-- (%d%%)",
+                     pager->total ? (int)(pager->shown * 100 / pager->total) : 100);
+    if (write(STDOUT_FILENO, prompt, (size_t)n) < 0) {
+        pager->quit = 1;
+        return;
+    }
+
+    char key = 0;
+    while (1) {
+        ssize_t r = read(STDIN_FILENO, &key, 1);
+        if (r <= 0 || key == 'q' || key == 'Q') {
+            pager->quit = 1;
+            break;
+        }
+        if (key == ' ') {
+            pager->lines_left = pager->page_lines;
+            break;
+        }
+        if (key == '\n' || key == '\r') {
+            pager->lines_left = 1;
+            break;
+        }
+    }
+    // 擦掉提示行
+    if (write(STDOUT_FILENO, "\r\033[K", 4) < 0) pager->quit = 1;
+}
+
+// 片段回调：逐行输出，一页满了就停下来等按键
+static int pager_segment(const void* data, size_t length, void* ctx) {
+    PagerState* pager = (PagerState*)ctx;
+    const char* p = (const char*)data;
+    const char* end = p + length;
+
+    while (p < end) {
+        if (pager->lines_left == 0) {
+            pager_prompt(pager);
+            if (pager->quit) return 1;
+        }
+        const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+        const char* stop = newline ? newline + 1 : end;
+        if (write(STDOUT_FILENO, p, (size_t)(stop - p)) < 0) return -1;
+        pager->shown += (size_t)(stop - p);
+        pager->last = stop[-1];
+        if (newline) pager->lines_left--;
+        p = stop;
+    }
+    return 0;
+}
+
+// more <filename>
+// 标准输入或输出不是终端时直接整体输出
+int execute_more(FileSystem* fs, const char* filename) {
+    if (!fs || !filename) {
+        printf("Usage: more <filename>\n");
+        return -1;
+    }
+
+    FileNode* file = find_file(fs, filename);
+    if (!file || file->is_directory || !isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        return view_file(fs, filename);
+    }
+
+    struct winsize window;
+    int rows = (ioctl(STDOUT_FILENO, TIOCGWINSZ, &window) == 0 && window.ws_row > 1) ? window.ws_row : 24;
+
+    // 关闭规范模式和回显，翻页时一个按键立即生效
+    struct termios oldt, newt;
+    if (tcgetattr(STDIN_FILENO, &oldt) != 0) {
+        return view_file(fs, filename);
+    }
+    newt = oldt;
+    newt.c_lflag &= ~(ICANON | ECHO);
+    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+
+    PagerState pager = {rows - 1, rows - 1, 0, file->size, 0, '\n'};
+    fflush(stdout);
+    int result = for_each_file_segment(fs, file, pager_segment, &pager);
+    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+
+    if (result != 0 && !pager.quit) {
+        printf("\nError: Cannot read '%s'\n", filename);
+        return -1;
+    }
+    if (!pager.quit && pager.last != '\n') printf("\n");
+    return 0;
+}
+
 // delete <filename>
 int execute_delete(FileSystem* fs, const char* filename) {
     if (!fs || !filename) {
@@ -295,3 +1134,34 @@ int execute_cd(FileSystem* fs, const char* dirname) {
         return -1;
     }
 }
+
+// save-image <host_path>
+int execute_save_image(FileSystem* fs, const char* image_path) {
+    if (!fs || !image_path) {
+        printf("Usage: save-image <host_path>\n");
+        return -1;
+    }
+
+    int files_saved = save_disk_image(fs, image_path);
+    if (files_saved >= 0) {
+        printf("Disk image saved to '%s' (%d files)\n", image_path, files_saved);
+        return 0;
+    } else {
+        printf("Error: Failed to save disk image to '%s'\n", image_path);
+        return -1;
+    }
+}
+
+// df
+int execute_df(FileSystem* fs) {
+    if (!fs) return -1;
+    print_disk_usage(fs);
+    return 0;
+}
+
+// dedup-stats
+int execute_dedup_stats(FileSystem* fs) {
+    if (!fs) return -1;
+    print_dedup_stats(fs);
+    return 0;
+}
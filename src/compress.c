@@ -0,0 +1,170 @@
+#include "../include/compress.h"
+#include <stdint.h>
+#include <string.h>
+
+// By Est
+// 文件内容压缩：单遍哈希匹配，速度优先；解压时对每个长度和偏移做越界检查，损坏的数据只会返回失败
+
+#define COMPRESS_HASH_BITS 12
+#define COMPRESS_LAST_LITERALS 5     // 末尾留作字面量的字节数，保证匹配时可以按 4 字节读取
+
+static uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash_sequence(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - COMPRESS_HASH_BITS);
+}
+
+// 写入扩展长度（token 中已经放了 15），返回新的写指针，空间不够返回 NULL
+static unsigned char* write_length(unsigned char* out, unsigned char* out_end, size_t length) {
+    while (length >= 255) {
+        if (out >= out_end) return NULL;
+        *out++ = 255;
+        length -= 255;
+    }
+    if (out >= out_end) return NULL;
+    *out++ = (unsigned char)length;
+    return out;
+}
+
+// 写出一个序列：literal_length 个字面量，之后是可选的匹配（match_length 为 0 表示没有匹配）
+static unsigned char* write_sequence(unsigned char* out, unsigned char* out_end,
+                                     const unsigned char* literals, size_t literal_length,
+                                     size_t offset, size_t match_length) {
+    if (out >= out_end) return NULL;
+    unsigned char* token = out++;
+    size_t match_code = match_length ? match_length - COMPRESS_MIN_MATCH : 0;
+    *token = (unsigned char)(((literal_length < 15 ? literal_length : 15) << 4) |
+                             (match_code < 15 ? match_code : 15));
+
+    if (literal_length >= 15 && !(out = write_length(out, out_end, literal_length - 15))) return NULL;
+    if ((size_t)(out_end - out) < literal_length) return NULL;
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    if (match_length) {
+        if (out_end - out < 2) return NULL;
+        *out++ = (unsigned char)(offset & 0xFF);
+        *out++ = (unsigned char)(offset >> 8);
+        if (match_code >= 15 && !(out = write_length(out, out_end, match_code - 15))) return NULL;
+    }
+    return out;
+}
+
+// 压缩结果的最大可能长度（全部是字面量时）
+size_t compress_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+/*
+ * 压缩 size 字节到 dst
+ *
+ * @param capacity  dst 的容量；压缩结果放不下时直接放弃，
+ *                  调用者可以传入小于 size 的容量来要求最低压缩率
+ *
+ * @return 压缩后的长度，放不下（不值得压缩）时返回0
+ */
+size_t compress_data(const void* src, size_t size, void* dst, size_t capacity) {
+    const unsigned char* in = (const unsigned char*)src;
+    const unsigned char* in_end = in + size;
+    unsigned char* out = (unsigned char*)dst;
+    unsigned char* out_end = out + capacity;
+    const unsigned char* anchor = in;   // 尚未输出的字面量起点
+
+    if (size > COMPRESS_LAST_LITERALS + COMPRESS_MIN_MATCH) {
+        uint32_t table[1 << COMPRESS_HASH_BITS];
+        memset(table, 0, sizeof(table));
+
+        const unsigned char* match_limit = in_end - COMPRESS_LAST_LITERALS;
+        const unsigned char* ip = in + 1;
+        while (ip + COMPRESS_MIN_MATCH <= match_limit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash_sequence(sequence);
+            const unsigned char* candidate = in + table[h];
+            table[h] = (uint32_t)(ip - in);
+
+            if (candidate >= ip || (size_t)(ip - candidate) > COMPRESS_MAX_OFFSET ||
+                read32(candidate) != sequence) {
+                ip++;
+                continue;
+            }
+
+            // 匹配向前延伸到还没输出的字面量里，向后延伸到 match_limit
+            while (ip > anchor && candidate > in && ip[-1] == candidate[-1]) {
+                ip--;
+                candidate--;
+            }
+            size_t match_length = COMPRESS_MIN_MATCH;
+            while (ip + match_length < match_limit && ip[match_length] == candidate[match_length]) {
+                match_length++;
+            }
+
+            out = write_sequence(out, out_end, anchor, (size_t)(ip - anchor),
+                                 (size_t)(ip - candidate), match_length);
+            if (!out) return 0;
+            ip += match_length;
+            anchor = ip;
+        }
+    }
+
+    out = write_sequence(out, out_end, anchor, (size_t)(in_end - anchor), 0, 0);
+    return out ? (size_t)(out - (unsigned char*)dst) : 0;
+}
+
+// 读取扩展长度，越界返回-1
+static int read_length(const unsigned char** ip, const unsigned char* in_end, size_t* length) {
+    unsigned char byte;
+    do {
+        if (*ip >= in_end) return -1;
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+/*
+ * 把 compress_data 的结果解压到 dst
+ *
+ * @param size  原始长度，解压结果必须正好是这么长
+ *
+ * @return 成功返回0，数据损坏返回-1
+ */
+int decompress_data(const void* src, size_t stored_size, void* dst, size_t size) {
+    const unsigned char* ip = (const unsigned char*)src;
+    const unsigned char* in_end = ip + stored_size;
+    unsigned char* out = (unsigned char*)dst;
+    unsigned char* op = out;
+    unsigned char* out_end = out + size;
+
+    while (ip < in_end) {
+        unsigned char token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && read_length(&ip, in_end, &literal_length) != 0) return -1;
+        if ((size_t)(in_end - ip) < literal_length || (size_t)(out_end - op) < literal_length) return -1;
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == in_end) break; // 最后一个序列没有匹配
+
+        if (in_end - ip < 2) return -1;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t match_length = token & 0x0F;
+        if (match_length == 15 && read_length(&ip, in_end, &match_length) != 0) return -1;
+        match_length += COMPRESS_MIN_MATCH;
+
+        if (offset == 0 || offset > (size_t)(op - out) || (size_t)(out_end - op) < match_length) return -1;
+        // 匹配可能与输出重叠（offset < match_length），只能逐字节复制
+        const unsigned char* match = op - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+    return op == out_end ? 0 : -1;
+}
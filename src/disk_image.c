@@ -0,0 +1,261 @@
+#include "../include/disk_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// By Est
+// 磁盘镜像的保存 / 加载：保存时把整个目录树打包成一个文件，
+// 加载时只做一次 mmap，文件节点的 data 直接指向映射内部（FILE_STORAGE_IMAGE）
+
+// 保存时按先序收集的节点
+typedef struct {
+    FileNode* node;
+    uint32_t parent;          // 父目录项下标 + 1，0 表示根目录
+} ImageItem;
+
+typedef struct {
+    ImageItem* items;
+    size_t count;
+    size_t capacity;
+} ImageItemList;
+
+static int push_item(ImageItemList* list, FileNode* node, uint32_t parent) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+        ImageItem* items = (ImageItem*)realloc(list->items, new_capacity * sizeof(ImageItem));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = new_capacity;
+    }
+    list->items[list->count].node = node;
+    list->items[list->count].parent = parent;
+    list->count++;
+    return 0;
+}
+
+// 先序收集 dir 的全部子孙节点，保证父目录排在子节点前面
+static int collect_items(ImageItemList* list, FileNode* dir, uint32_t dir_index) {
+    for (FileNode* child = dir->children; child; child = child->next) {
+        if (push_item(list, child, dir_index) != 0) return -1;
+        if (child->is_directory &&
+            collect_items(list, child, (uint32_t)list->count) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static uint64_t align_up(uint64_t value) {
+    return (value + DISK_IMAGE_ALIGN - 1) & ~(uint64_t)(DISK_IMAGE_ALIGN - 1);
+}
+
+static int write_padding(FILE* fp, uint64_t from, uint64_t to) {
+    static const char zeros[DISK_IMAGE_ALIGN] = {0};
+    return (to > from && fwrite(zeros, 1, to - from, fp) != to - from) ? -1 : 0;
+}
+
+static int write_image_segment(const void* data, size_t length, void* ctx) {
+    return fwrite(data, 1, length, (FILE*)ctx) == length ? 0 : -1;
+}
+
+// 把文件系统整体保存为镜像文件，成功返回保存的文件数，失败返回 -1
+// 先写入临时文件再 rename，避免写到一半时覆盖掉旧镜像
+int save_disk_image(FileSystem* fs, const char* image_path) {
+    if (!fs || !image_path) return -1;
+
+    ImageItemList list = {NULL, 0, 0};
+    if (collect_items(&list, fs->root, 0) != 0 || list.count > UINT32_MAX) {
+        free(list.items);
+        return -1;
+    }
+
+    DiskImageEntry* entries = (DiskImageEntry*)calloc(list.count ? list.count : 1, sizeof(DiskImageEntry));
+    if (!entries) {
+        free(list.items);
+        return -1;
+    }
+
+    // 第一遍：计算文件名表和数据区布局
+    uint64_t names_size = 0;
+    uint64_t data_size = 0;
+    int files_saved = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        FileNode* node = list.items[i].node;
+        size_t name_length = strlen(node->filename);
+        entries[i].parent = list.items[i].parent;
+        entries[i].flags = node->is_directory ? DISK_IMAGE_FLAG_DIR : 0;
+        entries[i].name_offset = (uint32_t)names_size;
+        entries[i].name_length = (uint32_t)name_length;
+        names_size += name_length + 1;
+        if (!node->is_directory) {
+            data_size = align_up(data_size);
+            entries[i].data_offset = data_size;
+            entries[i].size = node->size;
+            data_size += node->size;
+            files_saved++;
+        }
+    }
+    if (names_size > UINT32_MAX) {
+        free(entries);
+        free(list.items);
+        return -1;
+    }
+
+    DiskImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISK_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = DISK_IMAGE_VERSION;
+    header.entry_count = (uint32_t)list.count;
+    header.names_offset = sizeof(DiskImageHeader) + list.count * sizeof(DiskImageEntry);
+    header.names_size = names_size;
+    header.data_offset = align_up(header.names_offset + names_size);
+    header.data_size = data_size;
+
+    // 路径放不下时不能截断：截断后的临时文件会被改名到错误的位置
+    char temp_path[512];
+    FILE* fp = NULL;
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", image_path) >= (int)sizeof(temp_path)) {
+        errno = ENAMETOOLONG;
+    } else {
+        fp = fopen(temp_path, "wb");
+    }
+    if (!fp) {
+        free(entries);
+        free(list.items);
+        return -1;
+    }
+
+    // 第二遍：依次写入头、目录表、文件名表和数据区
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             (list.count == 0 || fwrite(entries, sizeof(DiskImageEntry), list.count, fp) == list.count);
+    for (size_t i = 0; ok && i < list.count; i++) {
+        FileNode* node = list.items[i].node;
+        ok = fwrite(node->filename, 1, entries[i].name_length + 1, fp) == entries[i].name_length + 1;
+    }
+    ok = ok && write_padding(fp, header.names_offset + names_size, header.data_offset) == 0;
+
+    uint64_t written = 0;
+    for (size_t i = 0; ok && i < list.count; i++) {
+        FileNode* node = list.items[i].node;
+        if (node->is_directory) continue;
+        // 按片段写出：分块存储的文件不需要先拼接，延迟加载的文件在这里读入
+        ok = write_padding(fp, written, entries[i].data_offset) == 0 &&
+             for_each_file_segment(fs, node, write_image_segment, fp) == 0;
+        written = entries[i].data_offset + node->size;
+    }
+
+    if (fclose(fp) != 0) ok = 0;
+    free(entries);
+    free(list.items);
+
+    if (!ok || rename(temp_path, image_path) != 0) {
+        unlink(temp_path);
+        return -1;
+    }
+    return files_saved;
+}
+
+// 检查目录表是否完全落在映射范围内，避免损坏的镜像导致越界访问
+static int validate_image(const unsigned char* base, size_t image_size) {
+    if (image_size < sizeof(DiskImageHeader)) return -1;
+
+    const DiskImageHeader* header = (const DiskImageHeader*)base;
+    if (memcmp(header->magic, DISK_IMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != DISK_IMAGE_VERSION) {
+        return -1;
+    }
+
+    uint64_t table_end = sizeof(DiskImageHeader) + (uint64_t)header->entry_count * sizeof(DiskImageEntry);
+    if (table_end > image_size || header->names_offset < table_end ||
+        header->names_offset > image_size || header->names_size > image_size - header->names_offset ||
+        header->data_offset > image_size || header->data_size > image_size - header->data_offset) {
+        return -1;
+    }
+
+    const DiskImageEntry* entries = (const DiskImageEntry*)(base + sizeof(DiskImageHeader));
+    const char* names = (const char*)(base + header->names_offset);
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const DiskImageEntry* entry = &entries[i];
+        // 父目录必须出现在当前项之前，且确实是目录
+        if (entry->parent > i ||
+            (entry->parent > 0 && !(entries[entry->parent - 1].flags & DISK_IMAGE_FLAG_DIR))) {
+            return -1;
+        }
+        if ((uint64_t)entry->name_offset + entry->name_length >= header->names_size ||
+            names[entry->name_offset + entry->name_length] != '\0' || entry->name_length == 0) {
+            return -1;
+        }
+        if (!(entry->flags & DISK_IMAGE_FLAG_DIR) &&
+            (entry->data_offset > header->data_size || entry->size > header->data_size - entry->data_offset)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 从镜像文件加载：整份镜像只 mmap 一次，文件内容不复制
+// 成功返回加载的文件数，失败返回 -1（文件系统保持不变）
+int load_disk_image(FileSystem* fs, const char* image_path) {
+    if (!fs || !image_path || fs->image_base) return -1;
+
+    int fd = open(image_path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat image_stat;
+    if (fstat(fd, &image_stat) != 0 || image_stat.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t image_size = (size_t)image_stat.st_size;
+    void* base = mmap(NULL, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    if (validate_image((const unsigned char*)base, image_size) != 0) {
+        munmap(base, image_size);
+        return -1;
+    }
+
+    const DiskImageHeader* header = (const DiskImageHeader*)base;
+    const DiskImageEntry* entries = (const DiskImageEntry*)((const unsigned char*)base + sizeof(DiskImageHeader));
+    const char* names = (const char*)base + header->names_offset;
+    unsigned char* data = (unsigned char*)base + header->data_offset;
+
+    FileNode** nodes = (FileNode**)calloc(header->entry_count ? header->entry_count : 1, sizeof(FileNode*));
+    if (!nodes) {
+        munmap(base, image_size);
+        return -1;
+    }
+
+    // 映射交给文件系统管理，之后由 destroy_file_system 统一解除
+    fs->image_base = base;
+    fs->image_size = image_size;
+
+    FileNode* saved_dir = fs->current_dir;
+    int files_loaded = 0;
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const DiskImageEntry* entry = &entries[i];
+        FileNode* parent = entry->parent ? nodes[entry->parent - 1] : fs->root;
+        if (!parent) continue; // 父目录创建失败，跳过整棵子树
+
+        fs->current_dir = parent;
+        const char* name = names + entry->name_offset;
+        if (entry->flags & DISK_IMAGE_FLAG_DIR) {
+            nodes[i] = create_directory(fs, name);
+        } else {
+            nodes[i] = adopt_file(fs, name, parent->path, data + entry->data_offset,
+                                  (size_t)entry->size, FILE_STORAGE_IMAGE);
+            if (nodes[i]) files_loaded++;
+        }
+    }
+    fs->current_dir = saved_dir;
+
+    free(nodes);
+    return files_loaded;
+}
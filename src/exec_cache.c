@@ -0,0 +1,118 @@
+#include "../include/exec_cache.h"
+#include <stdio.h>
+#include <unistd.h>
+
+// ruby(run-cache)：exec 缓存与进程表一样是模块内的全局状态，只在 CLI 线程中访问
+static ExecCacheEntry cache_entries[EXEC_CACHE_SLOTS];
+static size_t cache_bytes = 0;
+static unsigned long cache_clock = 0;
+static size_t cache_hits = 0;
+static size_t cache_misses = 0;
+static size_t cache_evictions = 0;
+static size_t cache_invalidations = 0;
+
+static void drop_entry(ExecCacheEntry* entry) {
+    close(entry->fd);
+    cache_bytes -= entry->size;
+    entry->fd = -1;
+}
+
+// 初始化缓存（所有槽位为空）
+void init_exec_cache(void) {
+    for (int i = 0; i < EXEC_CACHE_SLOTS; i++) {
+        cache_entries[i].fd = -1;
+    }
+    cache_bytes = 0;
+    cache_clock = 0;
+    cache_hits = cache_misses = cache_evictions = cache_invalidations = 0;
+}
+
+// 关闭所有缓存的 memfd
+void cleanup_exec_cache(void) {
+    for (int i = 0; i < EXEC_CACHE_SLOTS; i++) {
+        if (cache_entries[i].fd >= 0) drop_entry(&cache_entries[i]);
+    }
+}
+
+// 查找内容相同的已准备好的程序，命中返回 fd（仍归缓存所有，调用者不要关闭），未命中返回 -1
+int exec_cache_lookup(uint64_t hash, size_t size) {
+    for (int i = 0; i < EXEC_CACHE_SLOTS; i++) {
+        ExecCacheEntry* entry = &cache_entries[i];
+        if (entry->fd >= 0 && entry->hash == hash && entry->size == size) {
+            entry->last_used = ++cache_clock;
+            cache_hits++;
+            return entry->fd;
+        }
+    }
+    cache_misses++;
+    return -1;
+}
+
+/*
+ * 把一个已封印的 memfd 放入缓存，成功后 fd 归缓存所有
+ *
+ * 空间不够时按 LRU 淘汰旧项；单个程序超过 EXEC_CACHE_MAX_BYTES 时不缓存。
+ *
+ * @return 成功返回0，不缓存时返回-1（fd 仍归调用者）
+ */
+int exec_cache_insert(uint64_t hash, size_t size, int fd) {
+    if (fd < 0 || size > EXEC_CACHE_MAX_BYTES) return -1;
+
+    ExecCacheEntry* slot = NULL;
+    while (1) {
+        ExecCacheEntry* oldest = NULL;
+        slot = NULL;
+        for (int i = 0; i < EXEC_CACHE_SLOTS; i++) {
+            ExecCacheEntry* entry = &cache_entries[i];
+            if (entry->fd < 0) {
+                if (!slot) slot = entry;
+            } else if (!oldest || entry->last_used < oldest->last_used) {
+                oldest = entry;
+            }
+        }
+        if (slot && cache_bytes + size <= EXEC_CACHE_MAX_BYTES) break;
+        if (!oldest) return -1;
+        drop_entry(oldest);
+        cache_evictions++;
+    }
+
+    slot->hash = hash;
+    slot->size = size;
+    slot->fd = fd;
+    slot->last_used = ++cache_clock;
+    cache_bytes += size;
+    return 0;
+}
+
+// 文件系统变化通知（set_file_change_hook）：文件被删除、改名或修改时丢弃对应内容的缓存
+void exec_cache_file_changed(FileSystem* fs, FileNode* file, void* ctx) {
+    (void)fs;
+    (void)ctx;
+    if (!file || !file->content_hash_valid) return; // 没算过哈希的文件不可能在缓存里
+
+    for (int i = 0; i < EXEC_CACHE_SLOTS; i++) {
+        ExecCacheEntry* entry = &cache_entries[i];
+        if (entry->fd >= 0 && entry->hash == file->content_hash && entry->size == file->size) {
+            drop_entry(entry);
+            cache_invalidations++;
+        }
+    }
+}
+
+// 打印缓存统计
+// cache-stats
+void print_exec_cache_stats(void) {
+    int entries = 0;
+    for (int i = 0; i < EXEC_CACHE_SLOTS; i++) {
+        if (cache_entries[i].fd >= 0) entries++;
+    }
+    size_t lookups = cache_hits + cache_misses;
+    printf("=== Exec Cache ===\n");
+    printf("Entries:         %d / %d\n", entries, EXEC_CACHE_SLOTS);
+    printf("Cached bytes:    %zu / %u\n", cache_bytes, EXEC_CACHE_MAX_BYTES);
+    printf("Hits:            %zu\n", cache_hits);
+    printf("Misses:          %zu\n", cache_misses);
+    printf("Hit rate:        %.1f%%\n", lookups ? 100.0 * (double)cache_hits / (double)lookups : 0.0);
+    printf("Evictions:       %zu\n", cache_evictions);
+    printf("Invalidations:   %zu\n", cache_invalidations);
+}
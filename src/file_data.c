@@ -0,0 +1,258 @@
+#include "../include/file_data.h"
+#include "../include/compress.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define BLOCK_STORE_INITIAL_BUCKETS 1024
+
+// By Est
+// 文件内容缓冲区：只负责分配和释放，引用计数与大小统计由 file_system.c 在 data_lock 下维护
+// 去重块存储：内容按 DEDUP_CHUNK_SIZE 切块，按内容哈希登记，相同的块只保存一份
+
+// 接管 data 创建缓冲区（引用计数从 1 开始），失败时 data 仍归调用者
+FileBuffer* create_file_buffer(void* data, size_t size, FileStorage storage) {
+    FileBuffer* buffer = (FileBuffer*)malloc(sizeof(FileBuffer));
+    if (!buffer) return NULL;
+
+    buffer->refcount = 1;
+    buffer->storage = storage;
+    buffer->data = data;
+    buffer->size = size;
+    buffer->capacity = size;
+    buffer->stored_size = size;
+    buffer->host_path = NULL;
+    buffer->chunks = NULL;
+    buffer->chunk_count = 0;
+    return buffer;
+}
+
+// 创建延迟加载的缓冲区：只记录主机路径和大小
+FileBuffer* create_lazy_buffer(const char* host_path, size_t size) {
+    char* path_copy = strdup(host_path);
+    if (!path_copy) return NULL;
+
+    FileBuffer* buffer = create_file_buffer(NULL, size, FILE_STORAGE_LAZY);
+    if (!buffer) {
+        free(path_copy);
+        return NULL;
+    }
+    buffer->host_path = path_copy;
+    return buffer;
+}
+
+// 接管压缩后的内容创建缓冲区，size 为解压后的长度
+FileBuffer* create_compressed_buffer(void* packed, size_t stored_size, size_t size) {
+    FileBuffer* buffer = create_file_buffer(packed, size, FILE_STORAGE_COMPRESSED);
+    if (!buffer) return NULL;
+    buffer->capacity = stored_size;
+    buffer->stored_size = stored_size;
+    return buffer;
+}
+
+// 压缩一份文件内容，压缩率达不到 COMPRESS_MAX_RATIO 时返回 NULL（按原样保存更划算）
+// 成功时返回 malloc 分配的压缩结果，长度通过 stored_size 返回
+void* compress_file_data(const void* data, size_t size, size_t* stored_size) {
+    size_t limit = size / 100 * COMPRESS_MAX_RATIO + size % 100 * COMPRESS_MAX_RATIO / 100;
+    if (!data || !stored_size || limit == 0) return NULL;
+
+    unsigned char* packed = (unsigned char*)malloc(limit);
+    if (!packed) return NULL;
+    size_t length = compress_data(data, size, packed, limit);
+    if (length == 0) {
+        free(packed);
+        return NULL;
+    }
+
+    void* shrunk = realloc(packed, length);
+    *stored_size = length;
+    return shrunk ? shrunk : packed;
+}
+
+// 按存储方式释放一段内容
+void free_storage_data(void* data, size_t size, FileStorage storage) {
+    if (!data) return;
+    if (storage == FILE_STORAGE_MMAP) {
+        munmap(data, size);
+    } else if (storage == FILE_STORAGE_HEAP || storage == FILE_STORAGE_LAZY ||
+               storage == FILE_STORAGE_COMPRESSED) {
+        free(data);
+    }
+    // FILE_STORAGE_IMAGE：属于整体镜像映射，在 destroy_file_system 中统一解除
+}
+
+// 64 位块内容哈希：按 8 字节为单位混合，比逐字节的 FNV 快；冲突由 memcmp 兜底
+static uint64_t hash_chunk(const unsigned char* bytes, size_t length) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h ^= word * 0xFF51AFD7ED558CCDULL;
+        h = (h << 31 | h >> 33) * 0xC4CEB9FE1A85EC53ULL;
+    }
+    for (; i < length; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return h;
+}
+
+BlockStore* create_block_store(void) {
+    BlockStore* store = (BlockStore*)calloc(1, sizeof(BlockStore));
+    if (!store) return NULL;
+
+    store->buckets = (DataChunk**)calloc(BLOCK_STORE_INITIAL_BUCKETS, sizeof(DataChunk*));
+    if (!store->buckets) {
+        free(store);
+        return NULL;
+    }
+    store->bucket_count = BLOCK_STORE_INITIAL_BUCKETS;
+    return store;
+}
+
+// 销毁块存储（此时所有缓冲区都应已释放，剩余的块一并回收）
+void destroy_block_store(BlockStore* store) {
+    if (!store) return;
+    for (size_t i = 0; i < store->bucket_count; i++) {
+        DataChunk* chunk = store->buckets[i];
+        while (chunk) {
+            DataChunk* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+    }
+    free(store->buckets);
+    free(store);
+}
+
+// 块数量超过桶数量时桶数翻倍
+static void grow_block_store(BlockStore* store) {
+    size_t new_count = store->bucket_count * 2;
+    DataChunk** new_buckets = (DataChunk**)calloc(new_count, sizeof(DataChunk*));
+    if (!new_buckets) return; // 扩容失败只影响查找速度
+
+    for (size_t i = 0; i < store->bucket_count; i++) {
+        DataChunk* chunk = store->buckets[i];
+        while (chunk) {
+            DataChunk* next = chunk->next;
+            size_t slot = chunk->hash & (new_count - 1);
+            chunk->next = new_buckets[slot];
+            new_buckets[slot] = chunk;
+            chunk = next;
+        }
+    }
+    free(store->buckets);
+    store->buckets = new_buckets;
+    store->bucket_count = new_count;
+}
+
+// 登记一个块：已有相同内容则增加引用，否则复制一份保存
+static DataChunk* intern_chunk(BlockStore* store, const unsigned char* bytes, size_t length) {
+    uint64_t hash = hash_chunk(bytes, length);
+    for (DataChunk* chunk = store->buckets[hash & (store->bucket_count - 1)]; chunk; chunk = chunk->next) {
+        if (chunk->hash == hash && chunk->length == length && memcmp(chunk->bytes, bytes, length) == 0) {
+            chunk->refcount++;
+            store->chunk_refs++;
+            store->logical_bytes += length;
+            return chunk;
+        }
+    }
+
+    DataChunk* chunk = (DataChunk*)malloc(sizeof(DataChunk) + length);
+    if (!chunk) return NULL;
+    chunk->hash = hash;
+    chunk->length = length;
+    chunk->refcount = 1;
+    memcpy(chunk->bytes, bytes, length);
+
+    if (store->chunk_count + 1 > store->bucket_count) {
+        grow_block_store(store);
+    }
+    size_t slot = hash & (store->bucket_count - 1);
+    chunk->next = store->buckets[slot];
+    store->buckets[slot] = chunk;
+    store->chunk_count++;
+    store->chunk_refs++;
+    store->logical_bytes += length;
+    store->stored_bytes += length;
+    return chunk;
+}
+
+// 释放一个块引用，最后一个引用消失时从存储中移除
+static void release_chunk(BlockStore* store, DataChunk* chunk) {
+    store->chunk_refs--;
+    store->logical_bytes -= chunk->length;
+    if (--chunk->refcount > 0) return;
+
+    DataChunk** slot = &store->buckets[chunk->hash & (store->bucket_count - 1)];
+    while (*slot && *slot != chunk) slot = &(*slot)->next;
+    if (*slot) *slot = chunk->next;
+    store->chunk_count--;
+    store->stored_bytes -= chunk->length;
+    free(chunk);
+}
+
+// 把 data 切块登记到块存储，返回分块缓冲区（data 仍归调用者）
+FileBuffer* create_chunked_buffer(BlockStore* store, const void* data, size_t size) {
+    if (!store || !data) return NULL;
+
+    size_t chunk_count = (size + DEDUP_CHUNK_SIZE - 1) / DEDUP_CHUNK_SIZE;
+    DataChunk** chunks = (DataChunk**)malloc((chunk_count ? chunk_count : 1) * sizeof(DataChunk*));
+    if (!chunks) return NULL;
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < chunk_count; i++) {
+        size_t offset = i * DEDUP_CHUNK_SIZE;
+        size_t length = size - offset < DEDUP_CHUNK_SIZE ? size - offset : DEDUP_CHUNK_SIZE;
+        chunks[i] = intern_chunk(store, bytes + offset, length);
+        if (!chunks[i]) {
+            while (i > 0) release_chunk(store, chunks[--i]);
+            free(chunks);
+            return NULL;
+        }
+    }
+
+    FileBuffer* buffer = create_file_buffer(NULL, size, FILE_STORAGE_CHUNKED);
+    if (!buffer) {
+        for (size_t i = 0; i < chunk_count; i++) release_chunk(store, chunks[i]);
+        free(chunks);
+        return NULL;
+    }
+    buffer->chunks = chunks;
+    buffer->chunk_count = chunk_count;
+    return buffer;
+}
+
+// 按存储方式释放缓冲区内容和缓冲区本身（分块缓冲区需要传入所属的块存储）
+void free_file_buffer(BlockStore* store, FileBuffer* buffer) {
+    if (!buffer) return;
+
+    if (buffer->chunks) {
+        for (size_t i = 0; store && i < buffer->chunk_count; i++) {
+            release_chunk(store, buffer->chunks[i]);
+        }
+        free(buffer->chunks);
+    }
+
+    free_storage_data(buffer->data, buffer->size, buffer->storage);
+    free(buffer->host_path);
+    free(buffer);
+}
+
+// 从主机路径读入 size 字节到新的堆缓冲区，失败返回 NULL
+void* read_host_data(const char* host_path, size_t size) {
+    FILE* fp = fopen(host_path, "rb");
+    if (!fp) return NULL;
+
+    void* data = malloc(size ? size : 1);
+    if (data && fread(data, 1, size, fp) != size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    return data;
+}
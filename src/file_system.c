@@ -1,10 +1,118 @@
 #include "../include/file_system.h"
+#include "../include/compress.h"
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#define DIR_INDEX_INITIAL_BUCKETS 16
+#define APPEND_MIN_CAPACITY 4096          // 追加缓冲区的最小容量
+#define APPEND_MAX_CAPACITY (1 << 20)     // 追加缓冲区按文件大小成比例增长的上限
+#define VIEW_CHUNK_SIZE (64 * 1024)       // view / head / tail 每次 write(2) 的最大字节数
+
+// 目录索引：每个目录维护一张按文件名哈希的桶表，children 链表只负责保持插入顺序（list 使用）
+// FNV-1a 字符串哈希
+static size_t hash_name(const char* name) {
+    size_t h = (size_t)14695981039346656037ULL;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h ^= *p;
+        h *= (size_t)1099511628211ULL;
+    }
+    return h;
+}
+
+// 初始化节点的链表/索引字段
+static void init_node_links(FileNode* node, FileNode* parent) {
+    node->children = NULL;
+    node->next = NULL;
+    node->prev = NULL;
+    node->parent = parent;
+    node->tail = NULL;
+    node->buckets = NULL;
+    node->bucket_count = 0;
+    node->child_count = 0;
+    node->hash_next = NULL;
+}
+
+// 把节点挂到桶链尾部，保证同名节点的查找顺序与插入顺序一致
+static void index_insert(FileNode** buckets, size_t bucket_count, FileNode* node) {
+    FileNode** slot = &buckets[hash_name(node->filename) & (bucket_count - 1)];
+    while (*slot) slot = &(*slot)->hash_next;
+    node->hash_next = NULL;
+    *slot = node;
+}
+
+// 负载因子超过 1 时桶数量翻倍；按 children 顺序重建，保持同名节点顺序
+static int index_grow(FileNode* dir) {
+    size_t new_count = dir->bucket_count ? dir->bucket_count * 2 : DIR_INDEX_INITIAL_BUCKETS;
+    FileNode** new_buckets = (FileNode**)calloc(new_count, sizeof(FileNode*));
+    if (!new_buckets) return -1;
+
+    for (FileNode* child = dir->children; child; child = child->next) {
+        index_insert(new_buckets, new_count, child);
+    }
+    free(dir->buckets);
+    dir->buckets = new_buckets;
+    dir->bucket_count = new_count;
+    return 0;
+}
+
+// 将节点追加到目录：链表尾 O(1)，哈希索引期望 O(1)
+static int link_child(FileNode* dir, FileNode* node) {
+    if (dir->child_count + 1 > dir->bucket_count && index_grow(dir) != 0) {
+        return -1;
+    }
+
+    node->parent = dir;
+    node->next = NULL;
+    node->prev = dir->tail;
+    if (dir->tail) {
+        dir->tail->next = node;
+    } else {
+        dir->children = node;
+    }
+    dir->tail = node;
+    index_insert(dir->buckets, dir->bucket_count, node);
+    dir->child_count++;
+    return 0;
+}
+
+// 从哈希桶中移除节点（按节点当前的文件名定位桶）
+static void index_remove(FileNode* dir, FileNode* node) {
+    FileNode** slot = &dir->buckets[hash_name(node->filename) & (dir->bucket_count - 1)];
+    while (*slot && *slot != node) slot = &(*slot)->hash_next;
+    if (*slot) *slot = node->hash_next;
+    node->hash_next = NULL;
+}
+
+// 从目录中摘除节点（不释放内存）
+static void unlink_child(FileNode* dir, FileNode* node) {
+    index_remove(dir, node);
+
+    if (node->prev) node->prev->next = node->next; else dir->children = node->next;
+    if (node->next) node->next->prev = node->prev; else dir->tail = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+    dir->child_count--;
+}
+
+// 在目录中按名字查找文件或子目录
+static FileNode* lookup_child(FileNode* dir, const char* name, bool is_directory) {
+    if (!dir || dir->bucket_count == 0) return NULL;
+
+    FileNode* node = dir->buckets[hash_name(name) & (dir->bucket_count - 1)];
+    for (; node; node = node->hash_next) {
+        if (node->is_directory == is_directory && strcmp(node->filename, name) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
 // By Est
 // 初始化文件系统
 FileSystem* init_file_system(void) {
@@ -20,52 +128,247 @@ FileSystem* init_file_system(void) {
     
     root->filename = strdup("/");
     root->path = strdup("/");
-    root->data = NULL;
+    root->extents = NULL;
+    root->extent_count = 0;
+    root->extent_capacity = 0;
     root->size = 0;
+    root->content_hash = 0;
+    root->content_hash_valid = false;
     root->is_directory = true;
     // 这里每次都只连接一个节点（链表）
     // 所以同级和子集都存在顺序（横向，纵向）
-    root->children = NULL;
-    root->next = NULL;
-    root->parent = NULL;
+    init_node_links(root, NULL);
     
     fs->root = root;
     fs->current_dir = root;
     fs->total_size = 0;
+    fs->physical_size = 0;
+    fs->resident_size = 0;
+    pthread_mutex_init(&fs->data_lock, NULL);
+    fs->image_base = NULL;
+    fs->image_size = 0;
+    fs->block_store = NULL;
+    fs->compressed_files = 0;
+    fs->compressed_bytes = 0;
+    memset(&fs->decompress_cache, 0, sizeof(fs->decompress_cache));
+    fs->change_hook = NULL;
+    fs->change_ctx = NULL;
     
     return fs;
 }
 
-// 递归释放文件节点及其子节点
-static void free_file_node(FileNode* node) {
-    if (!node) return;
+// 注册文件变化通知（删除 / 改名 / 修改内容前调用），hook 为 NULL 时取消
+void set_file_change_hook(FileSystem* fs, FileChangeFn hook, void* ctx) {
+    if (!fs) return;
+    fs->change_hook = hook;
+    fs->change_ctx = ctx;
+}
+
+// 通知文件即将变化；content_changed 时缓存的内容哈希同时失效
+static void notify_file_change(FileSystem* fs, FileNode* file, bool content_changed) {
+    if (fs->change_hook) fs->change_hook(fs, file, fs->change_ctx);
+    if (content_changed) file->content_hash_valid = false;
+}
 
-    // 先释放子节点，再处理兄弟节点，避免悬挂指针
-    free_file_node(node->children);
-    free_file_node(node->next);
+// 打开去重：之后新加入的文件内容都切块登记到块存储中
+int enable_dedup(FileSystem* fs) {
+    if (!fs) return -1;
+    if (fs->block_store) return 0;
+
+    fs->block_store = create_block_store();
+    return fs->block_store ? 0 : -1;
+}
+
+// 节点开始引用一个新建的缓冲区：计入物理大小和常驻大小
+// 分块缓冲区的字节由块存储自己统计（stored_bytes），这里不重复计入
+// 压缩缓冲区按压缩后的字节数计入，解压后的内容只存在于解压缓存中
+static void account_new_buffer(FileSystem* fs, FileBuffer* buffer) {
+    if (buffer->storage == FILE_STORAGE_CHUNKED) return;
+
+    pthread_mutex_lock(&fs->data_lock);
+    fs->physical_size += buffer->stored_size;
+    if (buffer->data) fs->resident_size += buffer->stored_size;
+    if (buffer->storage == FILE_STORAGE_COMPRESSED) {
+        fs->compressed_files++;
+        fs->compressed_bytes += buffer->size;
+    }
+    pthread_mutex_unlock(&fs->data_lock);
+}
+
+// 从解压缓存中移除一项（调用者持有 data_lock）
+static void evict_cache_entry(FileSystem* fs, DecompressCacheEntry* entry) {
+    fs->decompress_cache.bytes -= entry->buffer->size;
+    free(entry->data);
+    entry->buffer = NULL;
+    entry->data = NULL;
+}
+
+// 压缩缓冲区被释放前丢弃它的解压缓存（调用者持有 data_lock）
+static void forget_compressed_buffer(FileSystem* fs, FileBuffer* buffer) {
+    for (int i = 0; i < DECOMPRESS_CACHE_SLOTS; i++) {
+        if (fs->decompress_cache.entries[i].buffer == buffer) {
+            evict_cache_entry(fs, &fs->decompress_cache.entries[i]);
+        }
+    }
+    fs->compressed_files--;
+    fs->compressed_bytes -= buffer->size;
+}
 
+// 增加一个区段对缓冲区的引用（copy / 拆分区段时共享内容）
+static void retain_buffer(FileSystem* fs, FileBuffer* buffer) {
+    pthread_mutex_lock(&fs->data_lock);
+    buffer->refcount++;
+    pthread_mutex_unlock(&fs->data_lock);
+}
+
+// 释放一个引用；最后一个引用消失时才真正释放内容
+static void release_buffer(FileSystem* fs, FileBuffer* buffer) {
+    if (!buffer) return;
+
+    pthread_mutex_lock(&fs->data_lock);
+    int last = --buffer->refcount == 0;
+    if (last && buffer->storage != FILE_STORAGE_CHUNKED) {
+        fs->physical_size -= buffer->stored_size;
+        if (buffer->data) fs->resident_size -= buffer->stored_size;
+        if (buffer->storage == FILE_STORAGE_COMPRESSED) forget_compressed_buffer(fs, buffer);
+    }
+    pthread_mutex_unlock(&fs->data_lock);
+
+    if (last) free_file_buffer(fs->block_store, buffer);
+}
+
+// 缓冲区大小变化（追加写入 / 截断回收）时同步物理大小和常驻大小
+static void account_buffer_resize(FileSystem* fs, FileBuffer* buffer, size_t new_size) {
+    pthread_mutex_lock(&fs->data_lock);
+    fs->physical_size = fs->physical_size - buffer->size + new_size;
+    fs->resident_size = fs->resident_size - buffer->size + new_size;
+    buffer->size = new_size;
+    buffer->stored_size = new_size;
+    pthread_mutex_unlock(&fs->data_lock);
+}
+
+// 释放单个节点自身占用的内存（不处理子节点）
+static void free_node_memory(FileSystem* fs, FileNode* node) {
     free(node->filename);
     free(node->path);
-    if (!node->is_directory && node->data) {
-        free(node->data);
+    for (size_t i = 0; i < node->extent_count; i++) {
+        release_buffer(fs, node->extents[i].buffer);
     }
+    free(node->extents);
+    free(node->buckets);
     free(node);
 }
 
+// 释放文件节点及其子树
+// 兄弟节点用循环处理，只对目录层级递归，避免大目录把栈压爆
+static void free_file_node(FileSystem* fs, FileNode* node) {
+    if (!node) return;
+
+    FileNode* child = node->children;
+    while (child) {
+        FileNode* next = child->next;
+        free_file_node(fs, child);
+        child = next;
+    }
+    free_node_memory(fs, node);
+}
+
 // 销毁文件系统
 // destroy file system to free the memory.
 void destroy_file_system(FileSystem* fs) {
     if (!fs) return;
     
-    free_file_node(fs->root);
+    free_file_node(fs, fs->root);
+    destroy_block_store(fs->block_store);
+    if (fs->image_base) {
+        munmap(fs->image_base, fs->image_size);
+    }
+    pthread_mutex_destroy(&fs->data_lock);
     
     free(fs);
 }
 
+// 创建一个没有内容的文件节点（尚未挂到目录上）
+static FileNode* alloc_file_node(FileSystem* fs, const char* filename, const char* path) {
+    FileNode* new_file = (FileNode*)malloc(sizeof(FileNode));
+    if (!new_file) return NULL;
+    
+    new_file->filename = strdup(filename);
+    new_file->path = path ? strdup(path) : strdup("/");
+    if (!new_file->filename || !new_file->path) {
+        free(new_file->filename);
+        free(new_file->path);
+        free(new_file);
+        return NULL;
+    }
+    new_file->extents = NULL;
+    new_file->extent_count = 0;
+    new_file->extent_capacity = 0;
+    new_file->size = 0;
+    new_file->content_hash = 0;
+    new_file->content_hash_valid = false;
+    new_file->is_directory = false;
+    init_node_links(new_file, fs->current_dir);
+    return new_file;
+}
+
+// 把文件节点挂到当前目录（链表尾 + 哈希索引）
+static int attach_file_node(FileSystem* fs, FileNode* new_file) {
+    if (link_child(fs->current_dir, new_file) != 0) {
+        return -1;
+    }
+    fs->total_size += new_file->size;
+    return 0;
+}
+
+// 保证区段数组至少能容纳 count 个区段
+static int reserve_extents(FileNode* file, size_t count) {
+    if (count <= file->extent_capacity) return 0;
+
+    size_t new_capacity = file->extent_capacity ? file->extent_capacity * 2 : 1;
+    while (new_capacity < count) new_capacity *= 2;
+    FileExtent* extents = (FileExtent*)realloc(file->extents, new_capacity * sizeof(FileExtent));
+    if (!extents) return -1;
+    file->extents = extents;
+    file->extent_capacity = new_capacity;
+    return 0;
+}
+
+// 在末尾追加一个区段，区段接管调用者对 buffer 的这一个引用（失败时引用仍归调用者）
+static int push_extent(FileNode* file, FileBuffer* buffer, size_t offset, size_t length) {
+    if (reserve_extents(file, file->extent_count + 1) != 0) return -1;
+
+    FileExtent* extent = &file->extents[file->extent_count++];
+    extent->buffer = buffer;
+    extent->offset = offset;
+    extent->length = length;
+    file->size += length;
+    return 0;
+}
+
+// 用新建的缓冲区创建文件节点并挂到当前目录，失败时连同缓冲区一起撤销（不释放 data）
+static FileNode* new_file_with_buffer(FileSystem* fs, const char* filename, const char* path, FileBuffer* buffer) {
+    if (!buffer) return NULL;
+
+    FileNode* new_file = alloc_file_node(fs, filename, path);
+    if (!new_file || push_extent(new_file, buffer, 0, buffer->size) != 0 ||
+        attach_file_node(fs, new_file) != 0) {
+        if (new_file) {
+            new_file->extent_count = 0; // 缓冲区在下面单独撤销
+            free_node_memory(fs, new_file);
+        }
+        buffer->data = NULL;
+        free_file_buffer(fs->block_store, buffer);
+        return NULL;
+    }
+    account_new_buffer(fs, buffer);
+    return new_file;
+}
+
 /*
  * 向文件系统当前目录添加一个文件
  *
- * 该函数创建一个新的文件节点，分配必要的内存，并将文件添加到当前目录的子节点链表中。
+ * 该函数创建一个新的文件节点，复制一份数据，并将文件添加到当前目录的子节点链表中。
  * 如果提供的路径为NULL，则使用根路径"/"作为默认路径。
  * 
  * @param fs      指向文件系统的指针，不能为NULL
@@ -78,40 +381,480 @@ void destroy_file_system(FileSystem* fs) {
  */
 FileNode* add_file(FileSystem* fs, const char* filename, const char* path, void* data, size_t size) {
     if (!fs || !filename || !data) return NULL;
-    
-    FileNode* new_file = (FileNode*)malloc(sizeof(FileNode));
-    if (!new_file) return NULL;
-    
-    new_file->filename = strdup(filename);
-    new_file->path = path ? strdup(path) : strdup("/");
-    new_file->data = malloc(size);
+
+    // 开启去重时直接从调用者的数据切块，不需要先复制一份
+    if (fs->block_store) {
+        FileNode* new_file = new_file_with_buffer(fs, filename, path,
+                                                  create_chunked_buffer(fs->block_store, data, size));
+        if (new_file) return new_file;
+    }
+
+    void* copy = malloc(size ? size : 1);
     // 数据为空时，撤销行为，然后退出
-    if (!new_file->data) {
-        free(new_file->filename);
-        free(new_file->path);
-        free(new_file);
-        return NULL;
+    if (!copy) return NULL;
+    memcpy(copy, data, size);
+
+    FileNode* new_file = adopt_file(fs, filename, path, copy, size, FILE_STORAGE_HEAP);
+    if (!new_file) {
+        free(copy);
     }
-    memcpy(new_file->data, data, size);
-    new_file->size = size;
-    new_file->is_directory = false;
-    new_file->children = NULL;
-    new_file->next = NULL;
-    new_file->parent = fs->current_dir;
-    
-    // 添加到当前目录的子节点链表
-    if (fs->current_dir->children == NULL) {
-        fs->current_dir->children = new_file;
+    return new_file;
+}
+
+/*
+ * 向当前目录添加文件，并直接接管 data 的所有权（不复制）
+ *
+ * 引导加载时使用：堆缓冲区或 mmap 映射直接挂到节点上，避免再分配一次、再拷贝一次。
+ * 开启去重时内容改为切块登记到块存储，原缓冲区随即释放。
+ * 成功后 data 由文件系统负责释放（按 storage 选择 free 或 munmap）；失败时所有权仍归调用者。
+ *
+ * @param storage  data 的来源，FILE_STORAGE_HEAP 或 FILE_STORAGE_MMAP
+ *
+ * @return 指向新创建的FileNode的指针，失败返回NULL
+ */
+FileNode* adopt_file(FileSystem* fs, const char* filename, const char* path, void* data, size_t size, FileStorage storage) {
+    if (!fs || !filename || !data) return NULL;
+
+    // 镜像内容本身就在一次映射里，不参与去重
+    if (fs->block_store && (storage == FILE_STORAGE_HEAP || storage == FILE_STORAGE_MMAP)) {
+        FileNode* new_file = new_file_with_buffer(fs, filename, path,
+                                                  create_chunked_buffer(fs->block_store, data, size));
+        if (new_file) {
+            free_storage_data(data, size, storage);
+            return new_file;
+        }
+    }
+
+    return new_file_with_buffer(fs, filename, path, create_file_buffer(data, size, storage));
+}
+
+/*
+ * 向当前目录添加一个压缩存储的文件，接管 packed（compress_file_data 的结果）
+ *
+ * 内容在读取时解压到解压缓存，不会常驻两份。失败时 packed 仍归调用者。
+ *
+ * @param stored_size  packed 的长度
+ * @param size         解压后的文件大小
+ *
+ * @return 指向新创建的FileNode的指针，失败返回NULL
+ */
+FileNode* adopt_compressed_file(FileSystem* fs, const char* filename, const char* path, void* packed, size_t stored_size, size_t size) {
+    if (!fs || !filename || !packed) return NULL;
+
+    return new_file_with_buffer(fs, filename, path, create_compressed_buffer(packed, stored_size, size));
+}
+
+/*
+ * 向当前目录添加一个延迟加载的文件
+ *
+ * 只记录文件名、大小和主机路径，内容在第一次通过 for_each_file_segment 访问时才读入。
+ *
+ * @param host_path  文件在主机上的路径，不能为NULL
+ * @param size       引导时 stat 得到的文件大小
+ *
+ * @return 指向新创建的FileNode的指针，失败返回NULL
+ */
+FileNode* add_lazy_file(FileSystem* fs, const char* filename, const char* path, const char* host_path, size_t size) {
+    if (!fs || !filename || !host_path) return NULL;
+
+    return new_file_with_buffer(fs, filename, path, create_lazy_buffer(host_path, size));
+}
+
+// 确保连续存储的缓冲区内容在内存中，返回内容指针（分块缓冲区返回 NULL）
+// 延迟加载的缓冲区在第一次访问时从主机读入：读盘在锁外进行，读完后在 data_lock 下安装，
+// 多个线程同时触发时只有一份会被采用
+static void* fault_in_buffer(FileSystem* fs, FileBuffer* buffer) {
+    // storage 创建后不再改变，只有延迟加载的缓冲区需要加锁
+    if (buffer->storage != FILE_STORAGE_LAZY) return buffer->data;
+
+    pthread_mutex_lock(&fs->data_lock);
+    void* data = buffer->data;
+    pthread_mutex_unlock(&fs->data_lock);
+    if (data) return data;
+
+    void* loaded = read_host_data(buffer->host_path, buffer->size);
+    if (!loaded) return NULL;
+
+    pthread_mutex_lock(&fs->data_lock);
+    if (buffer->data) {
+        // 其他线程已经先装好了，丢弃这一份
+        data = buffer->data;
+        free(loaded);
     } else {
-        FileNode* current = fs->current_dir->children;
-        while (current->next != NULL) {
-            current = current->next;
+        buffer->data = loaded;
+        fs->resident_size += buffer->size;
+        data = loaded;
+    }
+    pthread_mutex_unlock(&fs->data_lock);
+    return data;
+}
+
+/*
+ * 取得压缩缓冲区解压后的内容
+ *
+ * 最近解压过的内容保存在 DECOMPRESS_CACHE_SLOTS 个槽位中，按 LRU 淘汰，总字节数不超过
+ * DECOMPRESS_CACHE_MAX_BYTES（单个文件超过上限时缓存里只留它一个）。
+ * 返回的指针在下一次访问其他压缩文件之前有效，遍历片段时每次回调前重新获取即可。
+ *
+ * @return 解压后的内容，内存不足或数据损坏返回 NULL
+ */
+static void* decompress_buffer(FileSystem* fs, FileBuffer* buffer) {
+    DecompressCache* cache = &fs->decompress_cache;
+
+    pthread_mutex_lock(&fs->data_lock);
+    cache->clock++;
+    for (int i = 0; i < DECOMPRESS_CACHE_SLOTS; i++) {
+        if (cache->entries[i].buffer == buffer) {
+            cache->entries[i].last_used = cache->clock;
+            cache->hits++;
+            void* data = cache->entries[i].data;
+            pthread_mutex_unlock(&fs->data_lock);
+            return data;
         }
-        current->next = new_file;
     }
-    
-    fs->total_size += size;
-    return new_file;
+    cache->misses++;
+    pthread_mutex_unlock(&fs->data_lock);
+
+    void* data = malloc(buffer->size ? buffer->size : 1);
+    if (!data) return NULL;
+    if (decompress_data(buffer->data, buffer->stored_size, data, buffer->size) != 0) {
+        free(data);
+        return NULL;
+    }
+
+    // 腾出空间：先用空槽，否则淘汰最久未用的项，直到满足字节上限
+    pthread_mutex_lock(&fs->data_lock);
+    DecompressCacheEntry* slot = NULL;
+    while (1) {
+        DecompressCacheEntry* oldest = NULL;
+        slot = NULL;
+        for (int i = 0; i < DECOMPRESS_CACHE_SLOTS; i++) {
+            DecompressCacheEntry* entry = &cache->entries[i];
+            if (!entry->buffer) {
+                if (!slot) slot = entry;
+            } else if (!oldest || entry->last_used < oldest->last_used) {
+                oldest = entry;
+            }
+        }
+        if (!oldest || (slot && cache->bytes + buffer->size <= DECOMPRESS_CACHE_MAX_BYTES)) break;
+        evict_cache_entry(fs, oldest);
+    }
+    slot->buffer = buffer;
+    slot->data = data;
+    slot->last_used = cache->clock;
+    cache->bytes += buffer->size;
+    pthread_mutex_unlock(&fs->data_lock);
+    return data;
+}
+
+// 遍历一个区段中 [skip, skip + length) 这部分内容：连续缓冲区只有一个片段，分块缓冲区按块切成多个片段
+static int for_each_extent_segment(FileSystem* fs, const FileExtent* extent, size_t skip, size_t length,
+                                   FileSegmentFn fn, void* ctx) {
+    FileBuffer* buffer = extent->buffer;
+    if (length == 0) return 0;
+
+    if (buffer->storage == FILE_STORAGE_CHUNKED) {
+        size_t pos = extent->offset + skip;
+        size_t end = pos + length;
+        size_t index = pos / DEDUP_CHUNK_SIZE;
+        size_t chunk_skip = pos % DEDUP_CHUNK_SIZE;
+        while (pos < end) {
+            DataChunk* chunk = buffer->chunks[index++];
+            size_t n = chunk->length - chunk_skip;
+            if (n > end - pos) n = end - pos;
+            if (fn(chunk->bytes + chunk_skip, n, ctx) != 0) return -1;
+            pos += n;
+            chunk_skip = 0;
+        }
+        return 0;
+    }
+
+    unsigned char* data = buffer->storage == FILE_STORAGE_COMPRESSED
+        ? (unsigned char*)decompress_buffer(fs, buffer)
+        : (unsigned char*)fault_in_buffer(fs, buffer);
+    if (!data) return -1;
+    return fn(data + extent->offset + skip, length, ctx) != 0 ? -1 : 0;
+}
+
+/*
+ * 按顺序遍历文件内容 [offset, offset + length) 范围内的各个片段
+ *
+ * 范围之前的区段直接跳过，不会被读入或解压；length 超出文件末尾时截到末尾。
+ *
+ * @return 全部遍历完返回0；读入失败或 fn 中止返回-1
+ */
+int for_each_file_range(FileSystem* fs, FileNode* file, size_t offset, size_t length, FileSegmentFn fn, void* ctx) {
+    if (!fs || !file || file->is_directory || !fn) return -1;
+    if (offset >= file->size) return 0;
+    if (length > file->size - offset) length = file->size - offset;
+
+    size_t start = 0;
+    for (size_t i = 0; i < file->extent_count && length > 0; i++) {
+        const FileExtent* extent = &file->extents[i];
+        if (offset >= start + extent->length) {
+            start += extent->length;
+            continue;
+        }
+        size_t skip = offset - start;
+        size_t n = extent->length - skip < length ? extent->length - skip : length;
+        if (for_each_extent_segment(fs, extent, skip, n, fn, ctx) != 0) return -1;
+        offset += n;
+        length -= n;
+        start += extent->length;
+    }
+    return 0;
+}
+
+/*
+ * 按顺序遍历文件内容的各个片段（view / extract / save-image 等所有读内容的地方都应通过这里）
+ *
+ * 文件内容由若干区段拼接而成；连续存储的区段是一个片段，分块存储的区段每个块一个片段，
+ * 不需要先拼成一整块。延迟加载的文件在第一次访问时从主机读入。
+ *
+ * @param fn   每个片段调用一次，返回非0时停止遍历
+ * @param ctx  透传给 fn 的参数
+ *
+ * @return 全部遍历完返回0；读入失败或 fn 中止返回-1
+ */
+int for_each_file_segment(FileSystem* fs, FileNode* file, FileSegmentFn fn, void* ctx) {
+    return for_each_file_range(fs, file, 0, SIZE_MAX, fn, ctx);
+}
+
+// 片段回调：顺序拷贝到连续内存
+static int copy_segment(const void* data, size_t length, void* ctx) {
+    unsigned char** cursor = (unsigned char**)ctx;
+    memcpy(*cursor, data, length);
+    *cursor += length;
+    return 0;
+}
+
+// 片段回调：写入 FILE*
+static int write_segment(const void* data, size_t length, void* ctx) {
+    return fwrite(data, 1, length, (FILE*)ctx) == length ? 0 : -1;
+}
+
+// 片段回调：64 位 FNV-1a 流式哈希
+static int hash_segment(const void* data, size_t length, void* ctx) {
+    uint64_t h = *(uint64_t*)ctx;
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    *(uint64_t*)ctx = h;
+    return 0;
+}
+
+// 计算文件内容的 64 位哈希（exec 缓存的键）；结果缓存在节点上，内容修改前失效
+// @return 成功返回0，读取失败返回-1
+int file_content_hash(FileSystem* fs, FileNode* file, uint64_t* hash) {
+    if (!fs || !file || file->is_directory || !hash) return -1;
+
+    if (!file->content_hash_valid) {
+        uint64_t h = 14695981039346656037ULL ^ file->size;
+        if (for_each_file_segment(fs, file, hash_segment, &h) != 0) return -1;
+        file->content_hash = h;
+        file->content_hash_valid = true;
+    }
+    *hash = file->content_hash;
+    return 0;
+}
+
+// 找到文件，不存在时在当前目录创建一个空文件（write / append 使用）
+static FileNode* find_or_create_file(FileSystem* fs, const char* filename) {
+    FileNode* file = find_file(fs, filename);
+    if (file) return file;
+
+    file = alloc_file_node(fs, filename, fs->current_dir->path);
+    if (file && attach_file_node(fs, file) != 0) {
+        free_node_memory(fs, file);
+        return NULL;
+    }
+    return file;
+}
+
+// 保证文件内容的 pos 处是某个区段的起点，通过 index 返回该区段下标（pos == size 时为 extent_count）
+// 调用者需预先 reserve_extents 留出一个空位，这里不会失败
+static void split_extent_at(FileSystem* fs, FileNode* file, size_t pos, size_t* index) {
+    size_t start = 0;
+    size_t i = 0;
+    for (; i < file->extent_count; i++) {
+        FileExtent* extent = &file->extents[i];
+        if (pos == start) break;
+        if (pos < start + extent->length) {
+            // pos 落在区段内部：拆成两个区段，后半段再持有一个缓冲区引用
+            size_t head = pos - start;
+            memmove(&file->extents[i + 2], &file->extents[i + 1],
+                    (file->extent_count - i - 1) * sizeof(FileExtent));
+            file->extents[i + 1].buffer = extent->buffer;
+            file->extents[i + 1].offset = extent->offset + head;
+            file->extents[i + 1].length = extent->length - head;
+            extent->length = head;
+            retain_buffer(fs, extent->buffer);
+            file->extent_count++;
+            i++;
+            break;
+        }
+        start += extent->length;
+    }
+    *index = i;
+}
+
+// 追加 length 字节（data 为 NULL 时补零）
+// 末尾区段独占一个还有空余容量的堆缓冲区时直接写进去，否则新建一个按文件大小成比例放大的缓冲区，
+// 因此连续追加的均摊代价是 O(length)，与文件大小无关
+static int append_to_node(FileSystem* fs, FileNode* file, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    if (file->extent_count > 0) {
+        FileExtent* last = &file->extents[file->extent_count - 1];
+        FileBuffer* buffer = last->buffer;
+        pthread_mutex_lock(&fs->data_lock);
+        int appendable = buffer->storage == FILE_STORAGE_HEAP && buffer->refcount == 1 &&
+                         last->offset + last->length == buffer->size;
+        pthread_mutex_unlock(&fs->data_lock);
+
+        size_t spare = appendable ? buffer->capacity - buffer->size : 0;
+        size_t n = spare < length ? spare : length;
+        if (n > 0) {
+            unsigned char* dest = (unsigned char*)buffer->data + buffer->size;
+            if (bytes) memcpy(dest, bytes, n); else memset(dest, 0, n);
+            account_buffer_resize(fs, buffer, buffer->size + n);
+            last->length += n;
+            file->size += n;
+            fs->total_size += n;
+            if (bytes) bytes += n;
+            length -= n;
+        }
+    }
+    if (length == 0) return 0;
+
+    size_t capacity = file->size < APPEND_MIN_CAPACITY ? APPEND_MIN_CAPACITY :
+                      file->size > APPEND_MAX_CAPACITY ? APPEND_MAX_CAPACITY : file->size;
+    if (capacity < length) capacity = length;
+
+    unsigned char* storage = (unsigned char*)malloc(capacity);
+    if (!storage) return -1;
+    if (bytes) memcpy(storage, bytes, length); else memset(storage, 0, length);
+
+    FileBuffer* buffer = create_file_buffer(storage, length, FILE_STORAGE_HEAP);
+    if (!buffer || push_extent(file, buffer, 0, length) != 0) {
+        free(storage);
+        free(buffer);
+        return -1;
+    }
+    buffer->capacity = capacity;
+    account_new_buffer(fs, buffer);
+    fs->total_size += length;
+    return 0;
+}
+
+/*
+ * 在文件的 offset 处写入 length 字节（覆盖原内容，必要时扩展文件；文件不存在时创建）
+ *
+ * 新内容放进一个新的缓冲区，被覆盖的区段只是从区段列表中摘掉，
+ * 因此与其他文件共享的缓冲区不会被改动（写时复制只复制写入的这一段）。
+ * offset 超过文件末尾时，中间用 0 填充。
+ *
+ * @return 成功返回0，失败返回-1
+ */
+int write_to_file(FileSystem* fs, const char* filename, size_t offset, const void* data, size_t length) {
+    if (!fs || !filename || (!data && length > 0)) return -1;
+
+    FileNode* file = find_or_create_file(fs, filename);
+    if (!file) return -1;
+    notify_file_change(fs, file, true);
+
+    if (offset > file->size && append_to_node(fs, file, NULL, offset - file->size) != 0) return -1;
+    if (length == 0) return 0;
+    if (offset == file->size) return append_to_node(fs, file, data, length);
+
+    // 最多拆出两个新区段，再插入一个新区段，先一次性预留好，后面的步骤不会失败
+    if (reserve_extents(file, file->extent_count + 3) != 0) return -1;
+
+    void* copy = malloc(length);
+    if (!copy) return -1;
+    memcpy(copy, data, length);
+    FileBuffer* buffer = create_file_buffer(copy, length, FILE_STORAGE_HEAP);
+    if (!buffer) {
+        free(copy);
+        return -1;
+    }
+
+    size_t end = offset + length < file->size ? offset + length : file->size;
+    size_t first, last;
+    split_extent_at(fs, file, offset, &first);
+    split_extent_at(fs, file, end, &last);
+
+    // 摘掉被覆盖的区段 [first, last)，在原位置放入新区段
+    size_t removed = 0;
+    for (size_t i = first; i < last; i++) {
+        removed += file->extents[i].length;
+        release_buffer(fs, file->extents[i].buffer);
+    }
+    memmove(&file->extents[first + 1], &file->extents[last],
+            (file->extent_count - last) * sizeof(FileExtent));
+    file->extent_count = file->extent_count - (last - first) + 1;
+    file->extents[first].buffer = buffer;
+    file->extents[first].offset = 0;
+    file->extents[first].length = length;
+    account_new_buffer(fs, buffer);
+
+    file->size = file->size - removed + length;
+    fs->total_size = fs->total_size - removed + length;
+    return 0;
+}
+
+// 在文件末尾追加内容（文件不存在时创建）
+// append <filename> <text>
+int append_to_file(FileSystem* fs, const char* filename, const void* data, size_t length) {
+    if (!fs || !filename || (!data && length > 0)) return -1;
+
+    FileNode* file = find_or_create_file(fs, filename);
+    if (!file) return -1;
+    if (length == 0) return 0;
+    notify_file_change(fs, file, true);
+    return append_to_node(fs, file, data, length);
+}
+
+/*
+ * 把文件截断（或用 0 扩展）到 size 字节
+ *
+ * 截断只丢弃末尾的区段引用；末尾缓冲区为本区段独占时，把多出的部分还给后续的 append 使用。
+ *
+ * @return 成功返回0，失败返回-1
+ */
+int truncate_file(FileSystem* fs, const char* filename, size_t size) {
+    FileNode* file = find_file(fs, filename);
+    if (!file || file->is_directory) return -1;
+    if (size == file->size) return 0;
+    notify_file_change(fs, file, true);
+
+    if (size >= file->size) {
+        return size > file->size ? append_to_node(fs, file, NULL, size - file->size) : 0;
+    }
+    if (reserve_extents(file, file->extent_count + 1) != 0) return -1;
+
+    size_t keep;
+    split_extent_at(fs, file, size, &keep);
+    for (size_t i = keep; i < file->extent_count; i++) {
+        release_buffer(fs, file->extents[i].buffer);
+    }
+    file->extent_count = keep;
+    fs->total_size -= file->size - size;
+    file->size = size;
+
+    if (keep > 0) {
+        FileExtent* last = &file->extents[keep - 1];
+        FileBuffer* buffer = last->buffer;
+        pthread_mutex_lock(&fs->data_lock);
+        int reclaim = buffer->storage == FILE_STORAGE_HEAP && buffer->refcount == 1;
+        pthread_mutex_unlock(&fs->data_lock);
+        if (reclaim && last->offset + last->length < buffer->size) {
+            account_buffer_resize(fs, buffer, last->offset + last->length);
+        }
+    }
+    return 0;
 }
 
 // 查找文件
@@ -119,15 +862,8 @@ FileNode* add_file(FileSystem* fs, const char* filename, const char* path, void*
 FileNode* find_file(FileSystem* fs, const char* filename) {
     if (!fs || !filename) return NULL;
 
-    FileNode* current = fs->current_dir->children; // 被检查的文件，在当前目录current_dir下查找
-    while (current != NULL) {
-        if (strcmp(current->filename, filename) == 0 && !current->is_directory) {
-            return current;
-        }
-        current = current->next;
-    }
-    
-    return NULL;
+    // 在当前目录current_dir的哈希索引中查找
+    return lookup_child(fs->current_dir, filename, false);
 }
 
 
@@ -135,22 +871,92 @@ FileNode* find_file(FileSystem* fs, const char* filename) {
 // copy <filename>
 FileNode* copy_file(FileSystem* fs, const char* src_filename, const char* dest_filename) {
     FileNode* src_file = find_file(fs, src_filename);
-    if (!src_file) return NULL;
-    
-    return add_file(fs, dest_filename, fs->current_dir->path, src_file->data, src_file->size);
+    if (!src_file || !dest_filename) return NULL;
+
+    // 新节点复制区段列表并共享其中的缓冲区，不复制文件内容；之后任一方的写入只替换自己的区段
+    FileNode* new_file = alloc_file_node(fs, dest_filename, fs->current_dir->path);
+    if (!new_file) return NULL;
+    if (reserve_extents(new_file, src_file->extent_count) != 0) {
+        free_node_memory(fs, new_file);
+        return NULL;
+    }
+    for (size_t i = 0; i < src_file->extent_count; i++) {
+        FileExtent* extent = &src_file->extents[i];
+        retain_buffer(fs, extent->buffer);
+        push_extent(new_file, extent->buffer, extent->offset, extent->length);
+    }
+    if (attach_file_node(fs, new_file) != 0) {
+        free_node_memory(fs, new_file);
+        return NULL;
+    }
+    new_file->content_hash = src_file->content_hash;
+    new_file->content_hash_valid = src_file->content_hash_valid;
+    return new_file;
 }
 
 // 重命名文件
 // rename <filename>
 int rename_file(FileSystem* fs, const char* old_filename, const char* new_filename) {
     FileNode* file = find_file(fs, old_filename);
-    if (!file) return -1;
-    
+    if (!file || !new_filename) return -1;
+
+    char* name = strdup(new_filename);
+    if (!name) return -1;
+    notify_file_change(fs, file, false);
+
+    // 文件名变化后哈希桶也会变化：先摘出索引，改名后再挂回去（children 链表位置不变）
+    FileNode* dir = file->parent;
+    index_remove(dir, file);
     free(file->filename);
-    file->filename = strdup(new_filename); //由于是新分配，所以要释放原有的，防止内存泄漏
+    file->filename = name; //由于是新分配，所以要释放原有的，防止内存泄漏
+    index_insert(dir->buckets, dir->bucket_count, file);
     return 0;
 }
 
+/*
+ * 把文件 source 改名为 target；target 已存在时由 source 替换（管道输出 > file 使用）
+ *
+ * 唯一可能失败的分配在改动之前完成，失败时两个文件都保持原样；旧的 target 在改名成功后才删除
+ *
+ * @return 成功返回0，source 不存在或内存不足返回-1
+ */
+int replace_file(FileSystem* fs, const char* source, const char* target) {
+    FileNode* file = find_file(fs, source);
+    FileNode* old = target ? find_file(fs, target) : NULL;
+    if (!file || !target || old == file) return -1;
+
+    char* name = strdup(target);
+    if (!name) return -1;
+    notify_file_change(fs, file, false);
+    FileNode* dir = file->parent;
+    index_remove(dir, file);
+    free(file->filename);
+    file->filename = name;
+    if (old) {
+        notify_file_change(fs, old, true);
+        unlink_child(old->parent, old);
+        fs->total_size -= old->size;
+        free_node_memory(fs, old);
+    }
+    index_insert(dir->buckets, dir->bucket_count, file);
+    return 0;
+}
+
+// 文件内容实际占用的字节数：压缩区段按压缩率折算，其余区段按长度计算
+static size_t file_stored_size(const FileNode* file) {
+    size_t stored = 0;
+    for (size_t i = 0; i < file->extent_count; i++) {
+        const FileExtent* extent = &file->extents[i];
+        const FileBuffer* buffer = extent->buffer;
+        if (buffer->storage == FILE_STORAGE_COMPRESSED && buffer->size > 0) {
+            stored += (size_t)((double)buffer->stored_size * (double)extent->length / (double)buffer->size);
+        } else {
+            stored += extent->length;
+        }
+    }
+    return stored;
+}
+
 // 列出当前目录的所有文件
 // list
 void list_files(FileSystem* fs) {
@@ -168,64 +974,189 @@ void list_files(FileSystem* fs) {
         if (current->is_directory) {
             printf("  [DIR]  %s\n", current->filename);
         } else {
-            printf("  [FILE] %s (%zu bytes)\n", current->filename, current->size);
+            size_t stored = file_stored_size(current);
+            if (stored != current->size) {
+                printf("  [FILE] %s (%zu bytes, %zu stored)\n", current->filename, current->size, stored);
+            } else {
+                printf("  [FILE] %s (%zu bytes)\n", current->filename, current->size);
+            }
         }
         current = current->next;
     }
 }
 
-// 查看文件内容
-// view <filename>
-int view_file(FileSystem* fs, const char* filename) {
+// 片段回调：按 VIEW_CHUNK_SIZE 分块用 write(2) 写入 fd，处理部分写入和 EINTR
+static int write_fd_segment(const void* data, size_t length, void* ctx) {
+    int fd = *(int*)ctx;
+    const char* p = (const char*)data;
+    while (length > 0) {
+        size_t n = length < VIEW_CHUNK_SIZE ? length : VIEW_CHUNK_SIZE;
+        ssize_t written = write(fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+// 片段回调：写到标准输出，ctx 记录最后输出的字符，用来决定结尾是否需要补换行
+static int write_stdout_segment(const void* data, size_t length, void* ctx) {
+    int fd = STDOUT_FILENO;
+    if (length > 0) *(char*)ctx = ((const char*)data)[length - 1];
+    return write_fd_segment(data, length, &fd);
+}
+
+// 找到要查看的普通文件，找不到或是目录时打印错误
+static FileNode* find_viewable_file(FileSystem* fs, const char* filename) {
     FileNode* file = find_file(fs, filename);
     // 为空
     if (!file) {
         printf("Error: File '%s' not found\n", filename);
-        return -1;
+        return NULL;
     }
 
     // 是目录
     if (file->is_directory) {
         printf("Error: '%s' is a directory\n", filename);
+        return NULL;
+    }
+    return file;
+}
+
+// 流式输出文件的 [offset, offset + length) 部分，不需要先格式化整个内容
+static int stream_file_range(FileSystem* fs, FileNode* file, size_t offset, size_t length) {
+    // stdio 中还没刷出的提示信息必须排在文件内容前面
+    fflush(stdout);
+    char last = '\n';
+    if (for_each_file_range(fs, file, offset, length, write_stdout_segment, &last) != 0) {
+        printf("\nError: Cannot read '%s'\n", file->filename);
         return -1;
     }
-    
-    // 假设是文本文件，直接打印
-    printf("%.*s\n", (int)file->size, (char*)file->data);
+    if (last != '\n') printf("\n");
     return 0;
 }
 
-// 删除文件，文件不内含文件，只有目录会内含文件
-// delete <filename>
-int delete_file(FileSystem* fs, const char* filename) {
-    if (!fs || !filename) return -1;
+// 查看文件内容
+// view <filename>
+int view_file(FileSystem* fs, const char* filename) {
+    return view_file_range(fs, filename, 0, SIZE_MAX);
+}
 
-    FileNode* prev = NULL;
-    FileNode* current = fs->current_dir->children; //在当前目录下对文件进行查找
+// 查看文件的一部分（length 超出末尾时截到末尾）
+// view <filename> --offset N --length M
+int view_file_range(FileSystem* fs, const char* filename, size_t offset, size_t length) {
+    FileNode* file = find_viewable_file(fs, filename);
+    if (!file) return -1;
+    if (offset > file->size) {
+        printf("Error: Offset %zu is past the end of '%s' (%zu bytes)\n", offset, filename, file->size);
+        return -1;
+    }
+    return stream_file_range(fs, file, offset, length);
+}
 
-    while (current != NULL) {
-        if (strcmp(current->filename, filename) == 0 && !current->is_directory) {
-            // 从链表中移除
-            if (prev == NULL) {
-                fs->current_dir->children = current->next;
-            } else {
-                prev->next = current->next;
+// 数行的状态：head 向前找第 lines 个换行
+typedef struct {
+    size_t lines;              // 还要数的行数
+    size_t position;           // 已扫描的字节数
+} LineScan;
+
+// 片段回调：向前数换行，数够时停止（返回 1）
+static int count_lines_forward(const void* data, size_t length, void* ctx) {
+    LineScan* scan = (LineScan*)ctx;
+    const char* p = (const char*)data;
+    const char* end = p + length;
+    while (p < end) {
+        const char* newline = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!newline) break;
+        p = newline + 1;
+        if (--scan->lines == 0) {
+            scan->position += (size_t)(p - (const char*)data);
+            return 1;
+        }
+    }
+    scan->position += length;
+    return 0;
+}
+
+// 从文件末尾往前按 VIEW_CHUNK_SIZE 分窗扫描，返回最后 lines 行的起始偏移；读取失败返回 SIZE_MAX
+// 只读取实际要输出的那部分内容，与文件大小无关
+static size_t find_tail_offset(FileSystem* fs, FileNode* file, size_t lines) {
+    unsigned char* window = (unsigned char*)malloc(VIEW_CHUNK_SIZE);
+    if (!window) return SIZE_MAX;
+
+    // 末尾的换行属于最后一行，不单独算一行
+    size_t end = file->size;
+    size_t pos = end;
+    size_t found = 0;
+    size_t result = 0;
+    while (pos > 0) {
+        size_t start = pos > VIEW_CHUNK_SIZE ? pos - VIEW_CHUNK_SIZE : 0;
+        unsigned char* cursor = window;
+        if (for_each_file_range(fs, file, start, pos - start, copy_segment, &cursor) != 0) {
+            result = SIZE_MAX;
+            break;
+        }
+        size_t i = pos - start;
+        while (i > 0) {
+            if (window[i - 1] == '\n' && start + i != end && ++found == lines) {
+                result = start + i;
+                break;
             }
+            i--;
+        }
+        if (i > 0) break;
+        pos = start;
+    }
+    free(window);
+    return result;
+}
 
-            // 释放内存
-            fs->total_size -= current->size;
-            free(current->filename);
-            free(current->path);
-            free(current->data);
-            free(current);
+// 查看文件开头或末尾的若干行
+// head <filename> [lines] / tail <filename> [lines]
+int view_file_lines(FileSystem* fs, const char* filename, size_t lines, bool from_end) {
+    FileNode* file = find_viewable_file(fs, filename);
+    if (!file) return -1;
+    if (lines == 0) return 0;
 
-            return 0;
+    if (from_end) {
+        size_t offset = find_tail_offset(fs, file, lines);
+        if (offset == SIZE_MAX) {
+            printf("Error: Cannot read '%s'\n", filename);
+            return -1;
         }
-        prev = current;
-        current = current->next;
+        return stream_file_range(fs, file, offset, SIZE_MAX);
+    }
+
+    LineScan scan = {lines, 0};
+    if (for_each_file_segment(fs, file, count_lines_forward, &scan) != 0 && scan.lines != 0) {
+        printf("Error: Cannot read '%s'\n", filename);
+        return -1;
+    }
+    return stream_file_range(fs, file, 0, scan.position);
+}
+
+// 删除文件，文件不内含文件，只有目录会内含文件
+// delete <filename>
+int delete_file(FileSystem* fs, const char* filename) {
+    if (!fs || !filename) return -1;
+
+    FileNode* current = find_file(fs, filename); //在当前目录下对文件进行查找
+    if (!current) {
+        return -1; // 文件未找到
     }
 
-    return -1; // 文件未找到
+    notify_file_change(fs, current, true);
+    // 从链表和哈希索引中移除
+    unlink_child(fs->current_dir, current);
+
+    // 释放内存（共享的内容只有最后一个引用删除时才释放）
+    fs->total_size -= current->size;
+    free_node_memory(fs, current);
+
+    return 0;
 }
 
 // 创建目录
@@ -240,22 +1171,19 @@ FileNode* create_directory(FileSystem* fs, const char* dirname) {
     char* new_path = (char*)malloc(strlen(fs->current_dir->path) + strlen(dirname) + 2);
     sprintf(new_path, "%s%s/", fs->current_dir->path, dirname);
     new_dir->path = new_path;
-    new_dir->data = NULL;
+    new_dir->extents = NULL;
+    new_dir->extent_count = 0;
+    new_dir->extent_capacity = 0;
     new_dir->size = 0;
+    new_dir->content_hash = 0;
+    new_dir->content_hash_valid = false;
     new_dir->is_directory = true;
-    new_dir->children = NULL;
-    new_dir->next = NULL;
-    new_dir->parent = fs->current_dir;
+    init_node_links(new_dir, fs->current_dir);
     
     // 添加到当前目录
-    if (fs->current_dir->children == NULL) {
-        fs->current_dir->children = new_dir;
-    } else {
-        FileNode* current = fs->current_dir->children;
-        while (current->next != NULL) {
-            current = current->next;
-        }
-        current->next = new_dir;
+    if (link_child(fs->current_dir, new_dir) != 0) {
+        free_node_memory(fs, new_dir);
+        return NULL;
     }
     
     return new_dir;
@@ -276,18 +1204,71 @@ int change_directory(FileSystem* fs, const char* dirname) {
     }
     
     // 查找子目录
-    FileNode* current = fs->current_dir->children;
-    while (current != NULL) {
-        if (strcmp(current->filename, dirname) == 0 && current->is_directory) {
-            fs->current_dir = current;
-            return 0;
-        }
-        current = current->next;
+    FileNode* dir = lookup_child(fs->current_dir, dirname, true);
+    if (dir) {
+        fs->current_dir = dir;
+        return 0;
     }
     
     return -1; // 目录未找到
 }
 
+// 打印磁盘镜像的逻辑 / 物理 / 常驻大小
+// df
+void print_disk_usage(FileSystem* fs) {
+    if (!fs) return;
+
+    pthread_mutex_lock(&fs->data_lock);
+    size_t physical_size = fs->physical_size;
+    size_t resident_size = fs->resident_size;
+    pthread_mutex_unlock(&fs->data_lock);
+
+    // 去重块存储中的字节只保存一份，分别计入物理大小和常驻大小
+    if (fs->block_store) {
+        physical_size += fs->block_store->stored_bytes;
+        resident_size += fs->block_store->stored_bytes;
+    }
+
+    printf("Disk Image Size: %zu bytes (logical)\n", fs->total_size);
+    printf("Physical Size:   %zu bytes (shared contents counted once)\n", physical_size);
+    printf("Resident Size:   %zu bytes\n", resident_size);
+
+    pthread_mutex_lock(&fs->data_lock);
+    size_t compressed_files = fs->compressed_files;
+    size_t compressed_bytes = fs->compressed_bytes;
+    DecompressCache cache = fs->decompress_cache;
+    pthread_mutex_unlock(&fs->data_lock);
+    if (compressed_files > 0) {
+        size_t cached_files = 0;
+        for (int i = 0; i < DECOMPRESS_CACHE_SLOTS; i++) {
+            if (cache.entries[i].buffer) cached_files++;
+        }
+        printf("Compressed:      %zu files, %zu bytes uncompressed\n", compressed_files, compressed_bytes);
+        printf("Decompress Cache: %zu files, %zu bytes (hits %zu, misses %zu)\n",
+               cached_files, cache.bytes, cache.hits, cache.misses);
+    }
+}
+
+// 打印去重块存储的统计信息
+// dedup-stats
+void print_dedup_stats(FileSystem* fs) {
+    if (!fs) return;
+    if (!fs->block_store) {
+        printf("Deduplication is off (boot with --dedup to enable it)\n");
+        return;
+    }
+
+    BlockStore* store = fs->block_store;
+    size_t saved = store->logical_bytes - store->stored_bytes;
+    printf("=== Block Store (chunk size %d bytes) ===\n", DEDUP_CHUNK_SIZE);
+    printf("Unique chunks:   %zu\n", store->chunk_count);
+    printf("Chunk refs:      %zu\n", store->chunk_refs);
+    printf("Logical bytes:   %zu\n", store->logical_bytes);
+    printf("Stored bytes:    %zu\n", store->stored_bytes);
+    printf("Saved bytes:     %zu (%.1f%%)\n", saved,
+           store->logical_bytes ? 100.0 * (double)saved / (double)store->logical_bytes : 0.0);
+}
+
 // 打印文件信息
 void print_file_info(FileNode* file) {
     if (!file) return;
@@ -295,6 +1276,12 @@ void print_file_info(FileNode* file) {
            file->filename, file->size, file->path);
 }
 
+// 把文件内容写入一个已打开的 fd（run 写入 memfd 时使用），成功返回0
+int write_file_to_fd(FileSystem* fs, FileNode* file, int fd) {
+    if (!fs || !file || file->is_directory || fd < 0) return -1;
+    return for_each_file_segment(fs, file, write_fd_segment, &fd);
+}
+
 // 提取文件到主机系统，用于在进程管理运行程序
 int extract_file_to_host(FileSystem* fs, const char* filename, const char* host_path) {
     FileNode* file = find_file(fs, filename);
@@ -303,10 +1290,10 @@ int extract_file_to_host(FileSystem* fs, const char* filename, const char* host_
     FILE* fp = fopen(host_path, "wb");
     if (!fp) return -1;
 
-    size_t written = fwrite(file->data, 1, file->size, fp);
-    fclose(fp);
+    int result = for_each_file_segment(fs, file, write_segment, fp);
+    if (fclose(fp) != 0) result = -1;
 
-    if (written != file->size) return -1;
+    if (result != 0) return -1;
 
     // 设置可执行权限
     chmod(host_path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH);
@@ -2,9 +2,10 @@
 #include <stdio.h>
 
 int main(int argc, char* argv[]) {
-    (void)argc;  // 未使用参数
-    (void)argv;  // 未使用参数
-    // 启动 NeuBoot 引导加载器
-    neuboot_start();
-    return 0;
-}
\ No newline at end of file
+    BootOptions opts;
+    if (parse_boot_options(argc, argv, &opts) != 0) {
+        return 1;
+    }
+    // 启动 NeuBoot 引导加载器；批处理模式中有命令失败时退出码为 1
+    return neuboot_start(&opts);
+}
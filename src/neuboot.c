@@ -1,16 +1,203 @@
 #include "../include/neuboot.h"
+#include "../include/disk_image.h"
 #include "../include/commands.h"
+#include "../include/command_table.h"
 #include "../include/cli.h"
 #include "../include/process.h"
+#include "../include/exec_cache.h"
+#include "../include/zygote.h"
+#include "../include/cgroup.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-// 启动 NeuBoot 引导加载器
-void neuboot_start(void) {
+// 默认引导选项：堆加载
+void init_boot_options(BootOptions* opts) {
+    if (!opts) return;
+    opts->use_mmap = 0;
+    opts->image_path = NULL;
+    opts->dedup = 0;
+    opts->lazy_load = 0;
+    opts->boot_threads = 0;
+    opts->compress = 0;
+    opts->compress_min_size = DEFAULT_COMPRESS_MIN_SIZE;
+    opts->spawn_backend = SPAWN_BACKEND_POSIX_SPAWN;
+    opts->use_zygote = 0;
+    opts->max_processes = DEFAULT_MAX_PROCESSES;
+    opts->max_running = 0;
+    opts->cgroup_parent = NULL;
+    opts->script_path = NULL;
+    opts->exit_on_error = 0;
+    opts->stop_grace_ms = DEFAULT_STOP_GRACE_MS;
+    opts->capture_output = 0;
+    opts->output_ring_size = DEFAULT_OUTPUT_RING_SIZE;
+}
+
+static void print_boot_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("  --mmap        Map host files read-only instead of copying them (zero-copy boot)\n");
+    printf("  --dedup       Store file contents in a deduplicating block store\n");
+    printf("  --lazy        Record file metadata only; read contents on first access\n");
+    printf("  --image PATH  Boot from a disk image saved with 'save-image'\n");
+    printf("  --threads N   Worker threads for loading the host directory (default: online CPUs, max %d)\n",
+           MAX_BOOT_THREADS);
+    printf("  --compress    Store files that compress to <= %d%% of their size in compressed form\n",
+           COMPRESS_MAX_RATIO);
+    printf("  --compress-min N  Only compress files of at least N bytes (default: %d, implies --compress)\n",
+           DEFAULT_COMPRESS_MIN_SIZE);
+    printf("  --spawn posix|fork  How 'run' starts programs (default: posix_spawn, falls back to fork)\n");
+    printf("  --zygote      Fork a small launcher process before loading files; 'run' goes through it\n");
+    printf("  --max-procs N Process table capacity (default: %d, max %d)\n",
+           DEFAULT_MAX_PROCESSES, MAX_PROCESS_LIMIT);
+    printf("  --max-running N|cpus  Programs running at once, further 'run's are queued\n");
+    printf("                (default: process table capacity; 'cpus' = number of online CPUs)\n");
+    printf("  --cgroup DIR|auto  Put each program in its own cgroup v2 under DIR ('auto': the current cgroup)\n");
+    printf("  --capture     Capture program output in per-process buffers (read with 'plog')\n");
+    printf("  --log-size N  Bytes of output kept per process (default: %u, oldest output is dropped)\n",
+           DEFAULT_OUTPUT_RING_SIZE);
+    printf("  --stop-grace MS  Milliseconds 'stop' waits after SIGTERM before SIGKILL (default: %d)\n",
+           DEFAULT_STOP_GRACE_MS);
+    printf("  -f FILE       Run the commands in FILE instead of reading the terminal (batch mode);\n");
+    printf("                commands piped into stdin are run the same way\n");
+    printf("  --exit-on-error  In batch mode, stop at the first failed command (exit status 1)\n");
+    printf("  --help        Show this message\n");
+}
+
+// 解析命令行引导选项，成功返回 0；参数错误或 --help 返回 -1
+int parse_boot_options(int argc, char* argv[], BootOptions* opts) {
+    if (!opts) return -1;
+    init_boot_options(opts);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mmap") == 0) {
+            opts->use_mmap = 1;
+        } else if (strcmp(argv[i], "--dedup") == 0) {
+            opts->dedup = 1;
+        } else if (strcmp(argv[i], "--lazy") == 0) {
+            opts->lazy_load = 1;
+        } else if (strcmp(argv[i], "--image") == 0) {
+            if (i + 1 >= argc) {
+                printf("Error: --image requires a path\n");
+                return -1;
+            }
+            opts->image_path = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            char* endptr = NULL;
+            long threads = (i + 1 < argc) ? strtol(argv[i + 1], &endptr, 10) : 0;
+            if (i + 1 >= argc || *endptr != '\0' || threads <= 0 || threads > MAX_BOOT_THREADS) {
+                printf("Error: --threads requires a number between 1 and %d\n", MAX_BOOT_THREADS);
+                return -1;
+            }
+            opts->boot_threads = (int)threads;
+            i++;
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            opts->compress = 1;
+        } else if (strcmp(argv[i], "--compress-min") == 0) {
+            char* endptr = NULL;
+            long long min_size = (i + 1 < argc) ? strtoll(argv[i + 1], &endptr, 10) : -1;
+            if (i + 1 >= argc || *endptr != '\0' || min_size < 0) {
+                printf("Error: --compress-min requires a non-negative byte count\n");
+                return -1;
+            }
+            opts->compress = 1;
+            opts->compress_min_size = (size_t)min_size;
+            i++;
+        } else if (strcmp(argv[i], "--max-procs") == 0) {
+            char* endptr = NULL;
+            long capacity = (i + 1 < argc) ? strtol(argv[i + 1], &endptr, 10) : 0;
+            if (i + 1 >= argc || *endptr != '\0' || capacity <= 0 || capacity > MAX_PROCESS_LIMIT) {
+                printf("Error: --max-procs requires a number between 1 and %d\n", MAX_PROCESS_LIMIT);
+                return -1;
+            }
+            opts->max_processes = (int)capacity;
+            i++;
+        } else if (strcmp(argv[i], "--max-running") == 0) {
+            char* endptr = NULL;
+            long limit = (i + 1 < argc) ? strtol(argv[i + 1], &endptr, 10) : 0;
+            if (i + 1 < argc && strcmp(argv[i + 1], "cpus") == 0) {
+                limit = sysconf(_SC_NPROCESSORS_ONLN);
+                if (limit <= 0) limit = 1;
+            } else if (i + 1 >= argc || *endptr != '\0' || limit <= 0 || limit > MAX_PROCESS_LIMIT) {
+                printf("Error: --max-running requires 'cpus' or a number between 1 and %d\n", MAX_PROCESS_LIMIT);
+                return -1;
+            }
+            opts->max_running = (int)limit;
+            i++;
+        } else if (strcmp(argv[i], "--cgroup") == 0) {
+            if (i + 1 >= argc) {
+                printf("Error: --cgroup requires a cgroup v2 directory or 'auto'\n");
+                return -1;
+            }
+            opts->cgroup_parent = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            opts->capture_output = 1;
+        } else if (strcmp(argv[i], "--log-size") == 0) {
+            char* endptr = NULL;
+            long long size = (i + 1 < argc) ? strtoll(argv[i + 1], &endptr, 10) : -1;
+            if (i + 1 >= argc || *endptr != '\0' || size < MIN_OUTPUT_RING_SIZE || size > MAX_OUTPUT_RING_SIZE) {
+                printf("Error: --log-size requires a byte count between %u and %u\n",
+                       MIN_OUTPUT_RING_SIZE, MAX_OUTPUT_RING_SIZE);
+                return -1;
+            }
+            opts->capture_output = 1;
+            opts->output_ring_size = (size_t)size;
+            i++;
+        } else if (strcmp(argv[i], "--stop-grace") == 0) {
+            char* endptr = NULL;
+            long grace = (i + 1 < argc) ? strtol(argv[i + 1], &endptr, 10) : -1;
+            if (i + 1 >= argc || *endptr != '\0' || grace < 0 || grace > MAX_STOP_GRACE_MS) {
+                printf("Error: --stop-grace requires milliseconds between 0 and %d\n", MAX_STOP_GRACE_MS);
+                return -1;
+            }
+            opts->stop_grace_ms = (int)grace;
+            i++;
+        } else if (strcmp(argv[i], "--zygote") == 0) {
+            opts->use_zygote = 1;
+        } else if (strcmp(argv[i], "--spawn") == 0) {
+            const char* backend = (i + 1 < argc) ? argv[++i] : "";
+            if (strcmp(backend, "posix") == 0) {
+                opts->spawn_backend = SPAWN_BACKEND_POSIX_SPAWN;
+            } else if (strcmp(backend, "fork") == 0) {
+                opts->spawn_backend = SPAWN_BACKEND_FORK;
+            } else {
+                printf("Error: --spawn requires 'posix' or 'fork'\n");
+                return -1;
+            }
+        } else if (strcmp(argv[i], "-f") == 0) {
+            if (i + 1 >= argc) {
+                printf("Error: -f requires a script file\n");
+                return -1;
+            }
+            opts->script_path = argv[++i];
+        } else if (strcmp(argv[i], "--exit-on-error") == 0) {
+            opts->exit_on_error = 1;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_boot_usage(argv[0]);
+            return -1;
+        } else {
+            printf("Error: Unknown option '%s'\n", argv[i]);
+            print_boot_usage(argv[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 启动 NeuBoot 引导加载器；返回进程的退出码（批处理模式中有命令失败时为 1）
+int neuboot_start(const BootOptions* opts) {
+    BootOptions defaults;
+    if (!opts) {
+        init_boot_options(&defaults);
+        opts = &defaults;
+    }
+
     printf("========================================\n");
     printf("    NeuMiniOS Boot Loader (NeuBoot)\n");
     printf("========================================\n\n");
@@ -19,104 +206,430 @@ void neuboot_start(void) {
     FileSystem* fs = init_file_system();
     if (!fs) {
         printf("Error: Failed to initialize file system\n");
-        return;
+        return 1;
     }
     
+    // zygote 必须在启动回收线程和加载磁盘镜像之前分出：这时进程只有一个线程，地址空间最小，
+    // zygote 也不会继承回收线程的 epoll / pidfd；退回路径用的启动方式在分出之前设好
+    set_spawn_backend(opts->spawn_backend);
+    if (opts->use_zygote && start_zygote() != 0) {
+        printf("Warning: Failed to start zygote, programs will be launched directly\n");
+    }
+
     // ruby(init)：引导阶段初始化进程表，确保 CLI 运行前没有残留进程
     // 初始化进程表
-    init_process_table();
+    if (init_process_table(opts->max_processes) != 0) {
+        printf("Error: Failed to initialize process table\n");
+        stop_zygote();
+        destroy_file_system(fs);
+        return 1;
+    }
+    set_stop_grace(opts->stop_grace_ms);
+    set_max_running(opts->max_running);
+    if (opts->cgroup_parent && init_cgroup(opts->cgroup_parent) != 0) {
+        printf("Warning: Cannot use cgroup '%s' (%s), programs stay in the current cgroup\n",
+               opts->cgroup_parent, strerror(errno));
+    }
+    set_output_capture(opts->capture_output, opts->output_ring_size);
+    // run 的可执行文件缓存：文件删除 / 改名 / 修改时由文件系统通知失效
+    init_exec_cache();
+    set_file_change_hook(fs, exec_cache_file_changed, NULL);
 
     // Est:文件系统
-    // 从linux的目录加载文件到虚拟的磁盘（磁盘镜像）
-    printf("Loading files from directory: %s\n", DEFAULT_FILES_DIR);
-    int files_loaded = load_files_from_directory(fs, DEFAULT_FILES_DIR);
+    if (opts->dedup && enable_dedup(fs) != 0) {
+        printf("Warning: Failed to create block store, deduplication disabled\n");
+    }
+
+    int files_loaded = 0;
+    if (opts->image_path) {
+        // 从单文件磁盘镜像启动：整份镜像只映射一次
+        printf("Loading disk image: %s\n", opts->image_path);
+        files_loaded = load_disk_image(fs, opts->image_path);
+        if (files_loaded < 0) {
+            printf("Warning: Cannot load disk image '%s'\n", opts->image_path);
+            files_loaded = 0;
+        }
+    } else {
+        // 从linux的目录加载文件到虚拟的磁盘（磁盘镜像）
+        printf("Loading files from directory: %s%s\n", DEFAULT_FILES_DIR,
+               opts->lazy_load ? " (lazy)" : opts->use_mmap ? " (mmap)" : "");
+        files_loaded = load_files_from_directory(fs, DEFAULT_FILES_DIR, opts);
+    }
     printf("Loaded %d files into Disk Image\n\n", files_loaded);
 
     // 显示启动信息（加分项）
     display_boot_info(fs);
 
-    // 启动 CLI
+    // 启动 CLI：-f 脚本或标准输入不是终端时进入批处理模式
+    int batch = opts->script_path || !isatty(STDIN_FILENO);
     printf("\nNeuMiniOS ready. Starting CLI...\n");
-    printf("Type 'exit' to quit\n\n");
+    if (batch) {
+        printf("Running commands from %s\n\n", opts->script_path ? opts->script_path : "<stdin>");
+    } else {
+        printf("Type 'exit' to quit\n\n");
+    }
 
+    // 内置命令登记到命令表，其他模块的命令也在 CLI 启动前登记
+    if (register_builtin_commands() != 0) {
+        printf("Warning: Some built-in commands could not be registered\n");
+    }
     CLI* cli = init_cli();
+    if (cli && batch && open_batch_input(cli, opts->script_path, opts->exit_on_error) != 0) {
+        printf("Error: Cannot open script '%s' (%s)\n", opts->script_path ? opts->script_path : "<stdin>",
+               strerror(errno));
+        destroy_cli(cli);
+        cli = NULL;
+    }
     if (!cli) {
         printf("Error: Failed to initialize CLI\n");
         cleanup_process_table();
+        cleanup_cgroup();
+        stop_zygote();
+        cleanup_exec_cache();
+        clear_command_table();
         destroy_file_system(fs);
-        return;
+        return 1;
     }
     
+    // 命令从标准输入读取时，子进程的标准输入改为 /dev/null，不会读走后面的命令
+    int null_input = -1;
+    if (batch && !opts->script_path) {
+        null_input = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        set_child_input(null_input);
+    }
+
     // 淇：使用CLI主循环（集成命令执行系统）
     Process* pm = NULL;  // 淇：保持接口兼容，但实际不再使用
     cli_loop(cli, fs, pm);
+    int status = cli->failed > 0 ? 1 : 0;
     
     // 清理资源
     printf("\nShutting down NeuMiniOS...\n");
     destroy_cli(cli);
     cleanup_process_table();
+    if (null_input >= 0) close(null_input);
+    cleanup_cgroup();
+    stop_zygote();
+    cleanup_exec_cache();
+    clear_command_table();
     destroy_file_system(fs);
     printf("Goodbye!\n");
+    return status;
 }
 
-// Est:
-// 从目录加载文件到磁盘镜像
-int load_files_from_directory(FileSystem* fs, const char* directory_path) {
-    if (!fs || !directory_path) return 0;
-    
-    DIR* dir = opendir(directory_path);
-    if (!dir) {
-        printf("Warning: Cannot open directory '%s'\n", directory_path);
-        return 0;
+// 以只读私有映射读取主机文件，内容由 FileNode 直接接管，不经过用户态缓冲区
+static void* map_host_file(const char* file_path, size_t size) {
+    if (size == 0) return NULL; // 长度为 0 无法映射，交给堆路径处理
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // 映射建立后即可关闭描述符
+    return data == MAP_FAILED ? NULL : data;
+}
+
+// 引导加载时主机目录树中的一个节点（文件或目录）
+// 工作线程负责 stat / 读取 / 枚举目录，主线程最后按名字顺序统一挂到文件系统上
+typedef struct LoadEntry {
+    char* name;                   // 文件名
+    char* host_path;              // 主机上的完整路径
+    int is_directory;             // 由工作线程 stat 后填写
+    int loaded;                   // 1=内容已读入（文件）或已枚举（目录）
+    void* data;                   // 文件内容（堆缓冲区、mmap 映射或压缩后的内容）
+    size_t size;                  // 文件大小
+    size_t stored_size;           // 压缩后的长度（storage 为 FILE_STORAGE_COMPRESSED 时有效）
+    FileStorage storage;          // data 的来源
+    struct LoadEntry** children;  // 目录的子节点，按名字排序
+    size_t child_count;
+} LoadEntry;
+
+// 工作线程池共享的任务队列
+typedef struct {
+    LoadEntry** tasks;            // 待处理节点（栈，先处理最近发现的子树）
+    size_t count;
+    size_t capacity;
+    size_t pending;               // 已入队但尚未处理完的任务数，为 0 时全部完成
+    int use_mmap;
+    int lazy_load;
+    int compress;
+    size_t compress_min_size;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} LoadQueue;
+
+static LoadEntry* new_load_entry(const char* name, const char* host_path) {
+    LoadEntry* entry = (LoadEntry*)calloc(1, sizeof(LoadEntry));
+    if (!entry) return NULL;
+    entry->name = strdup(name);
+    entry->host_path = strdup(host_path);
+    if (!entry->name || !entry->host_path) {
+        free(entry->name);
+        free(entry->host_path);
+        free(entry);
+        return NULL;
     }
-    
-    struct dirent* entry;
-    struct stat file_stat;
-    char file_path[512];
-    int files_loaded = 0;
-    
-    while ((entry = readdir(dir)) != NULL) {
+    entry->storage = FILE_STORAGE_HEAP;
+    return entry;
+}
+
+// 释放节点树；已被 adopt_file 接管的 data 在挂载时已置为 NULL
+static void free_load_entry(LoadEntry* entry) {
+    if (!entry) return;
+    for (size_t i = 0; i < entry->child_count; i++) {
+        free_load_entry(entry->children[i]);
+    }
+    free_storage_data(entry->data, entry->size, entry->storage);
+    free(entry->children);
+    free(entry->name);
+    free(entry->host_path);
+    free(entry);
+}
+
+static int compare_load_entries(const void* a, const void* b) {
+    const LoadEntry* left = *(const LoadEntry* const*)a;
+    const LoadEntry* right = *(const LoadEntry* const*)b;
+    return strcmp(left->name, right->name);
+}
+
+// 把一批任务放入队列（调用者未持锁）
+static int push_load_tasks(LoadQueue* queue, LoadEntry** tasks, size_t n) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count + n > queue->capacity) {
+        size_t new_capacity = queue->capacity ? queue->capacity : 64;
+        while (new_capacity < queue->count + n) new_capacity *= 2;
+        LoadEntry** grown = (LoadEntry**)realloc(queue->tasks, new_capacity * sizeof(LoadEntry*));
+        if (!grown) {
+            pthread_mutex_unlock(&queue->lock);
+            return -1;
+        }
+        queue->tasks = grown;
+        queue->capacity = new_capacity;
+    }
+    memcpy(queue->tasks + queue->count, tasks, n * sizeof(LoadEntry*));
+    queue->count += n;
+    queue->pending += n;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+// 枚举目录：为每个子项建立节点，按名字排序后作为新任务入队
+static void scan_load_directory(LoadQueue* queue, LoadEntry* entry) {
+    DIR* dir = opendir(entry->host_path);
+    if (!dir) return;
+
+    size_t capacity = 0;
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
         // 跳过 . 和 ..
         // 保证只往下遍历，而不会返回上级
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
             continue;
         }
-        
-        // 构建完整路径
-        snprintf(file_path, sizeof(file_path), "%s/%s", directory_path, entry->d_name);
-        
-        // 获取文件信息
-        if (stat(file_path, &file_stat) != 0) {
+
+        size_t path_length = strlen(entry->host_path) + strlen(item->d_name) + 2;
+        char* child_path = (char*)malloc(path_length);
+        if (!child_path) continue;
+        snprintf(child_path, path_length, "%s/%s", entry->host_path, item->d_name);
+        LoadEntry* child = new_load_entry(item->d_name, child_path);
+        free(child_path);
+        if (!child) continue;
+
+        if (entry->child_count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            LoadEntry** grown = (LoadEntry**)realloc(entry->children, capacity * sizeof(LoadEntry*));
+            if (!grown) {
+                free_load_entry(child);
+                break;
+            }
+            entry->children = grown;
+        }
+        entry->children[entry->child_count++] = child;
+    }
+    closedir(dir);
+
+    // readdir 的顺序取决于主机文件系统，排序后挂载顺序才是确定的
+    qsort(entry->children, entry->child_count, sizeof(LoadEntry*), compare_load_entries);
+    entry->loaded = 1;
+    if (entry->child_count > 0 &&
+        push_load_tasks(queue, entry->children, entry->child_count) != 0) {
+        entry->loaded = 0;
+    }
+}
+
+// 处理一个节点：stat 后读取文件内容，或者继续枚举子目录
+static void process_load_entry(LoadQueue* queue, LoadEntry* entry) {
+    struct stat file_stat;
+    if (lstat(entry->host_path, &file_stat) != 0) return;
+
+    // 符号链接只跟随到普通文件，避免目录链接造成循环
+    if (S_ISLNK(file_stat.st_mode)) {
+        if (stat(entry->host_path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) return;
+    }
+
+    if (S_ISDIR(file_stat.st_mode)) {
+        entry->is_directory = 1;
+        scan_load_directory(queue, entry);
+        return;
+    }
+
+    // 只处理普通文件
+    if (!S_ISREG(file_stat.st_mode)) return;
+
+    entry->size = (size_t)file_stat.st_size;
+    if (queue->lazy_load) {
+        // 延迟加载：只记录大小和主机路径，内容等首次访问时再读
+        entry->storage = FILE_STORAGE_LAZY;
+        entry->loaded = 1;
+        return;
+    }
+    if (queue->use_mmap) {
+        entry->data = map_host_file(entry->host_path, entry->size);
+        if (entry->data) entry->storage = FILE_STORAGE_MMAP;
+    }
+    if (!entry->data) {
+        entry->data = read_host_data(entry->host_path, entry->size);
+        entry->storage = FILE_STORAGE_HEAP;
+    }
+    entry->loaded = entry->data != NULL;
+
+    // 压缩在工作线程里做，与其他文件的读取并行；压缩率不够的文件保持原样
+    if (entry->loaded && queue->compress && entry->size >= queue->compress_min_size) {
+        void* packed = compress_file_data(entry->data, entry->size, &entry->stored_size);
+        if (packed) {
+            free_storage_data(entry->data, entry->size, entry->storage);
+            entry->data = packed;
+            entry->storage = FILE_STORAGE_COMPRESSED;
+        }
+    }
+}
+
+// 工作线程主循环：队列空且没有进行中的任务时退出
+static void* load_worker(void* arg) {
+    LoadQueue* queue = (LoadQueue*)arg;
+
+    pthread_mutex_lock(&queue->lock);
+    while (1) {
+        while (queue->count == 0 && queue->pending > 0) {
+            pthread_cond_wait(&queue->cond, &queue->lock);
+        }
+        if (queue->count == 0) break;
+
+        LoadEntry* entry = queue->tasks[--queue->count];
+        pthread_mutex_unlock(&queue->lock);
+
+        process_load_entry(queue, entry);
+
+        pthread_mutex_lock(&queue->lock);
+        if (--queue->pending == 0) {
+            pthread_cond_broadcast(&queue->cond);
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+// 主线程：按排序后的顺序把节点挂到文件系统，目录用 create_directory 重建
+static int link_load_entry(FileSystem* fs, LoadEntry* dir_entry, FileNode* dir_node) {
+    int files_loaded = 0;
+
+    for (size_t i = 0; i < dir_entry->child_count; i++) {
+        LoadEntry* entry = dir_entry->children[i];
+        if (!entry->loaded) continue;
+
+        fs->current_dir = dir_node;
+        if (entry->is_directory) {
+            FileNode* sub_dir = create_directory(fs, entry->name);
+            if (sub_dir) {
+                files_loaded += link_load_entry(fs, entry, sub_dir);
+            }
             continue;
         }
-        
-        // 只处理普通文件
-        if (S_ISREG(file_stat.st_mode)) {
-            // 读取文件内容
-            FILE* fp = fopen(file_path, "rb");
-            if (fp) {
-                void* file_data = malloc(file_stat.st_size);
-                if (file_data) {
-                    size_t bytes_read = fread(file_data, 1, file_stat.st_size, fp);
-                    if (bytes_read == (size_t)file_stat.st_size) {
-                        // 添加到文件系统
-                        FileNode* file = add_file(fs, entry->d_name, "/", file_data, file_stat.st_size);
-                        if (file) {
-                            files_loaded++;
-                            printf("  Loaded: %s (%zu bytes)\n", entry->d_name, file_stat.st_size);
-                        } else {
-                            free(file_data);
-                        }
-                    } else {
-                        free(file_data);
-                    }
-                }
-                fclose(fp);
+
+        // 添加到文件系统（接管 data，不再复制；延迟加载的文件只登记主机路径）
+        FileNode* file = entry->storage == FILE_STORAGE_LAZY
+            ? add_lazy_file(fs, entry->name, dir_node->path, entry->host_path, entry->size)
+            : entry->storage == FILE_STORAGE_COMPRESSED
+            ? adopt_compressed_file(fs, entry->name, dir_node->path, entry->data, entry->stored_size, entry->size)
+            : adopt_file(fs, entry->name, dir_node->path, entry->data, entry->size, entry->storage);
+        if (file) {
+            entry->data = NULL;
+            files_loaded++;
+            if (entry->storage == FILE_STORAGE_COMPRESSED) {
+                printf("  Loaded: %s%s (%zu bytes, compressed to %zu)\n", dir_node->path, entry->name,
+                       entry->size, entry->stored_size);
+            } else {
+                printf("  Loaded: %s%s (%zu bytes%s)\n", dir_node->path, entry->name, entry->size,
+                       entry->storage == FILE_STORAGE_MMAP ? ", mapped" :
+                       entry->storage == FILE_STORAGE_LAZY ? ", lazy" : "");
             }
         }
     }
-    
-    closedir(dir);
+    return files_loaded;
+}
+
+// 计算实际使用的工作线程数：0 表示按在线 CPU 数自动选择
+static int resolve_boot_threads(const BootOptions* opts) {
+    int threads = opts ? opts->boot_threads : 0;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    return threads > MAX_BOOT_THREADS ? MAX_BOOT_THREADS : threads;
+}
+
+// Est:
+// 从目录加载文件到磁盘镜像
+// 递归遍历整个主机目录树：工作线程池并行 stat / 读取，主线程按名字顺序重建目录层次
+// 读到的缓冲区（或 mmap 映射）直接交给 adopt_file，每个文件只在内存中保留一份
+int load_files_from_directory(FileSystem* fs, const char* directory_path, const BootOptions* opts) {
+    if (!fs || !directory_path) return 0;
+
+    struct stat dir_stat;
+    if (stat(directory_path, &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode)) {
+        printf("Warning: Cannot open directory '%s'\n", directory_path);
+        return 0;
+    }
+
+    LoadEntry* root = new_load_entry(directory_path, directory_path);
+    if (!root) return 0;
+    root->is_directory = 1;
+
+    LoadQueue queue;
+    memset(&queue, 0, sizeof(queue));
+    queue.use_mmap = opts && opts->use_mmap;
+    queue.lazy_load = opts && opts->lazy_load;
+    queue.compress = opts && opts->compress;
+    queue.compress_min_size = opts ? opts->compress_min_size : DEFAULT_COMPRESS_MIN_SIZE;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.cond, NULL);
+
+    // 根目录先在主线程枚举，子项作为第一批任务
+    scan_load_directory(&queue, root);
+
+    int threads = resolve_boot_threads(opts);
+    pthread_t workers[MAX_BOOT_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, load_worker, &queue) != 0) break;
+        started++;
+    }
+    // 主线程也作为一个工作线程参与，threads=1 时即为单线程加载
+    load_worker(&queue);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&queue.cond);
+    pthread_mutex_destroy(&queue.lock);
+    free(queue.tasks);
+
+    FileNode* saved_dir = fs->current_dir;
+    int files_loaded = link_load_entry(fs, root, fs->current_dir);
+    fs->current_dir = saved_dir;
+
+    free_load_entry(root);
     return files_loaded;
 }
 
@@ -125,7 +638,7 @@ void display_boot_info(FileSystem* fs) {
     if (!fs) return;
     
     printf("=== Boot Information ===\n");
-    printf("Disk Image Size: %zu bytes\n", fs->total_size);
+    print_disk_usage(fs);
     
     // 列出所有加载的文件
     printf("\nFiles in Disk Image:\n");
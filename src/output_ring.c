@@ -0,0 +1,63 @@
+#include "../include/output_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ruby(plog)：环形缓冲区本身不加锁，由进程表的锁保护
+
+OutputRing* create_output_ring(size_t capacity) {
+    OutputRing* ring = (OutputRing*)calloc(1, sizeof(OutputRing));
+    if (!ring) return NULL;
+    ring->capacity = capacity;
+    return ring;
+}
+
+void destroy_output_ring(OutputRing* ring) {
+    if (!ring) return;
+    free(ring->data);
+    free(ring);
+}
+
+// 追加输出，超出容量的部分覆盖最旧的内容；内存不足返回-1
+int output_ring_append(OutputRing* ring, const char* data, size_t length) {
+    if (!ring->data) {
+        ring->data = (char*)malloc(ring->capacity);
+        if (!ring->data) return -1;
+    }
+    // 一次写入超过容量时只有最后 capacity 字节会留下
+    if (length > ring->capacity) {
+        ring->written += length - ring->capacity;
+        data += length - ring->capacity;
+        length = ring->capacity;
+    }
+    size_t start = (size_t)(ring->written % ring->capacity);
+    size_t first = ring->capacity - start < length ? ring->capacity - start : length;
+    memcpy(ring->data + start, data, first);
+    memcpy(ring->data, data + first, length - first);
+    ring->written += length;
+    return 0;
+}
+
+/*
+ * 从 *position 开始读出最多 size 字节，并把 *position 前移
+ *
+ * @param dropped  返回 *position 之后已被覆盖、读不到的字节数
+ *
+ * @return 读出的字节数，已经读到最新时返回0
+ */
+size_t output_ring_read(const OutputRing* ring, uint64_t* position, char* buffer, size_t size, uint64_t* dropped) {
+    *dropped = 0;
+    uint64_t oldest = ring->written > ring->capacity ? ring->written - ring->capacity : 0;
+    if (*position < oldest) {
+        *dropped = oldest - *position;
+        *position = oldest;
+    }
+    if (*position >= ring->written || !ring->data) return 0;
+
+    size_t length = (size_t)(ring->written - *position) < size ? (size_t)(ring->written - *position) : size;
+    size_t start = (size_t)(*position % ring->capacity);
+    size_t first = ring->capacity - start < length ? ring->capacity - start : length;
+    memcpy(buffer, ring->data + start, first);
+    memcpy(buffer + first, ring->data, length - first);
+    *position += length;
+    return length;
+}
@@ -0,0 +1,237 @@
+#define _GNU_SOURCE   // vmsplice / splice / SPLICE_F_*
+#include "../include/pipeline.h"
+#include "../include/process.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+// 一次前台搬运的状态
+typedef struct {
+    int input_fd;             // 第一级输入管道的写端（非阻塞），-1 表示没有或已关闭
+    int output_fd;            // 最后一级输出管道的读端（非阻塞），-1 表示没有或已读到 EOF
+    int sink_fd;              // 接收输出的 memfd
+    uint64_t collected;       // 已移进 sink_fd 的字节数
+    int interactive;          // 1=按 q 可以中止
+    int unread;               // 1=第一级没有读完输入就关闭了标准输入（或已退出）
+    int aborted;
+    int failed;
+} Pump;
+
+// 创建连接 NeuMiniOS 与管道一端的 pipe（两端都带 O_CLOEXEC，不会泄漏给其他子进程），返回0或-1
+int open_pipeline_pipe(int fds[2]) {
+    if (pipe2(fds, O_CLOEXEC) != 0) return -1;
+    // 加大管道缓冲区，减少 vmsplice / splice 的轮次（超过系统上限时保持默认大小）
+    fcntl(fds[1], F_SETPIPE_SZ, PIPELINE_PIPE_SIZE);
+    return 0;
+}
+
+// 创建接收 > file 输出的匿名内存文件，失败返回-1
+int create_pipeline_sink(void) {
+    return memfd_create("neuminios-output", MFD_CLOEXEC);
+}
+
+// 把输出管道中现有的数据 splice 进 memfd，读到 EOF 时关闭读端
+static void collect_output(Pump* pump) {
+    while (pump->output_fd >= 0) {
+        ssize_t n = splice(pump->output_fd, NULL, pump->sink_fd, NULL, PIPELINE_SPLICE_SIZE,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            pump->collected += (uint64_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        if (n < 0) {
+            printf("Error: Failed to collect pipeline output: %s\n", strerror(errno));
+            pump->failed = 1;
+        }
+        close(pump->output_fd);
+        pump->output_fd = -1;
+    }
+}
+
+static void close_input(Pump* pump) {
+    if (pump->input_fd >= 0) close(pump->input_fd);
+    pump->input_fd = -1;
+}
+
+// 第一级不再读取输入（已退出或关闭了标准输入）：停止送数据，管道中剩下的内容丢弃
+static void drop_input(Pump* pump) {
+    pump->unread = 1;
+    close_input(pump);
+}
+
+/*
+ * 等待一轮事件：输入管道可写、输出管道可读或按了 q
+ *
+ * @param want_input  1=等待输入管道可写（还有数据要送），0=只检查第一级是否已不再读取
+ * @param timeout_ms  没有事件时的最长等待
+ */
+static void wait_pump(Pump* pump, int want_input, int timeout_ms) {
+    struct pollfd fds[3];
+    int count = 0;
+    int input_index = -1, output_index = -1, key_index = -1;
+    if (pump->input_fd >= 0) {
+        // 不再送数据时 events 为 0：第一级退出后仍能收到 POLLERR
+        input_index = count;
+        fds[count++] = (struct pollfd){pump->input_fd, want_input ? POLLOUT : 0, 0};
+    }
+    if (pump->output_fd >= 0) {
+        output_index = count;
+        fds[count++] = (struct pollfd){pump->output_fd, POLLIN, 0};
+    }
+    if (pump->interactive) {
+        key_index = count;
+        fds[count++] = (struct pollfd){STDIN_FILENO, POLLIN, 0};
+    }
+    if (poll(fds, (nfds_t)count, timeout_ms) <= 0) return;
+
+    if (output_index >= 0 && fds[output_index].revents) collect_output(pump);
+    if (input_index >= 0 && (fds[input_index].revents & POLLERR)) drop_input(pump);
+    if (key_index >= 0 && fds[key_index].revents) {
+        char ch;
+        if (read(STDIN_FILENO, &ch, 1) <= 0 || ch == 'q' || ch == 'Q') pump->aborted = 1;
+    }
+}
+
+// 片段回调：用 vmsplice 把这段内容挂进输入管道，管道满时等待并顺便收集输出
+static int feed_segment(const void* data, size_t length, void* ctx) {
+    Pump* pump = (Pump*)ctx;
+    struct iovec iov = {(void*)data, length};
+    while (iov.iov_len > 0) {
+        if (pump->aborted || pump->failed) return -1;
+        if (pump->input_fd < 0) return 0;   // 第一级不再读取，剩下的内容丢弃
+        ssize_t n = vmsplice(pump->input_fd, &iov, 1, SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            iov.iov_base = (char*)iov.iov_base + n;
+            iov.iov_len -= (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EPIPE) {
+            drop_input(pump);
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            printf("Error: Failed to feed pipeline input: %s\n", strerror(errno));
+            pump->failed = 1;
+        } else {
+            wait_pump(pump, 1, PIPELINE_POLL_MS);
+        }
+    }
+    return 0;
+}
+
+/*
+ * 前台搬运管道的输入和输出，直到输入全部被第一级读走、输出读到 EOF（最后一级退出），或按 q 中止
+ *
+ * vmsplice 只是让管道引用文件内容所在的页，所以要等第一级把管道中的数据读完才返回，
+ * 之后文件再被修改或删除也不会影响已经送出的内容。
+ *
+ * @param input      < 的文件，NULL 表示没有输入重定向（input_fd 为 -1）
+ * @param input_fd   第一级输入管道的写端，由这里关闭
+ * @param output_fd  最后一级输出管道的读端，由这里关闭；-1 表示没有输出重定向
+ * @param sink_fd    接收输出的 memfd
+ * @param collected  返回收集到的输出字节数
+ *
+ * @return 完成返回0，按 q 中止返回1，第一级没有读完输入就退出（或关闭了标准输入）返回2，出错返回-1
+ */
+int pump_pipeline(FileSystem* fs, FileNode* input, int input_fd, int output_fd, int sink_fd, uint64_t* collected) {
+    Pump pump;
+    memset(&pump, 0, sizeof(pump));
+    pump.input_fd = input_fd;
+    pump.output_fd = output_fd;
+    pump.sink_fd = sink_fd;
+    if (input_fd >= 0) fcntl(input_fd, F_SETFL, O_NONBLOCK);
+    if (output_fd >= 0) fcntl(output_fd, F_SETFL, O_NONBLOCK);
+
+    // 只有第一级的输入来自文件时才读终端按键，否则终端输入留给子进程
+    struct termios oldt, newt;
+    pump.interactive = input && isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &oldt) == 0;
+    if (pump.interactive) {
+        newt = oldt;
+        newt.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+        printf("(press q to stop waiting for the pipeline)\n");
+        fflush(stdout);
+    }
+
+    // 第一级提前退出时 vmsplice 会触发 SIGPIPE：在本线程中先屏蔽，结束后丢弃
+    sigset_t pipe_signal, old_mask;
+    sigemptyset(&pipe_signal);
+    sigaddset(&pipe_signal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_signal, &old_mask);
+
+    if (input && for_each_file_segment(fs, input, feed_segment, &pump) != 0 && !pump.aborted) {
+        pump.failed = 1;
+    }
+    // 等第一级读完管道中的数据；第一级不读就退出时管道读端全部关闭，wait_pump 收到 POLLERR 后关闭写端
+    while (pump.input_fd >= 0 && !pump.aborted && !pump.failed) {
+        int pending = 0;
+        if (ioctl(pump.input_fd, FIONREAD, &pending) != 0 || pending == 0) break;
+        wait_pump(&pump, 0, 10);
+    }
+    close_input(&pump);
+    while (pump.output_fd >= 0 && !pump.aborted && !pump.failed) {
+        wait_pump(&pump, 0, PIPELINE_POLL_MS);
+    }
+    if (pump.output_fd >= 0) {
+        // 中止时把已经到达的输出收完再关闭，最后一级之后再写会收到 SIGPIPE
+        collect_output(&pump);
+        if (pump.output_fd >= 0) close(pump.output_fd);
+    }
+
+    struct timespec no_wait = {0, 0};
+    while (sigtimedwait(&pipe_signal, NULL, &no_wait) > 0) {
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    if (pump.interactive) tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+
+    *collected = pump.collected;
+    if (pump.failed) return -1;
+    if (pump.aborted) return 1;
+    return pump.unread ? 2 : 0;
+}
+
+/*
+ * 把收集到的输出保存为当前目录下的文件（已存在时替换）
+ *
+ * memfd 以只读私有映射交给文件节点（与从主机加载的文件一样），内容不再复制。
+ * 先以临时名字建好新文件，再改名替换旧文件：任何一步失败时旧文件保持原样
+ *
+ * @return 成功返回0，失败返回-1
+ */
+int store_pipeline_output(FileSystem* fs, const char* filename, int sink_fd, uint64_t size) {
+    if (size > SIZE_MAX) return -1;
+
+    char temp_name[64];
+    for (unsigned int i = 0;; i++) {
+        snprintf(temp_name, sizeof(temp_name), ".pipeline-output-%u", i);
+        if (!find_file(fs, temp_name)) break;
+    }
+
+    void* data = NULL;
+    if (size > 0) {
+        data = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, sink_fd, 0);
+        if (data == MAP_FAILED) return -1;
+    }
+    FileNode* file = size > 0
+        ? adopt_file(fs, temp_name, fs->current_dir->path, data, (size_t)size, FILE_STORAGE_MMAP)
+        : add_file(fs, temp_name, fs->current_dir->path, (void*)"", 0);
+    if (!file) {
+        if (data) munmap(data, (size_t)size);
+        return -1;
+    }
+    if (replace_file(fs, temp_name, filename) != 0) {
+        delete_file(fs, temp_name);
+        return -1;
+    }
+    return 0;
+}
@@ -1,4 +1,8 @@
+#define _GNU_SOURCE   // memfd_create / F_ADD_SEALS / pipe2 / strsignal
 #include "../include/process.h"
+#include "../include/zygote.h"
+#include "../include/output_ring.h"
+#include "../include/cgroup.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,227 +12,1612 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <spawn.h>
+#include <time.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <stdarg.h>
 
-static Process* process_list = NULL;
+extern char** environ;
+
+// ruby(plist/run/stop)：进程表是一个容量在启动时确定的槽位数组
+// - NeuMiniOS PID = 代数 * 容量 + 槽位下标 + 1，由 PID 直接算出槽位，查找为 O(1)；
+//   槽位每次释放后代数加 1，已经退出的进程的旧 PID 因代数不符被拒绝
+// - 空闲槽位用 FIFO 队列分配，刚释放的槽位最后才被重新使用
+// - 运行中的进程按启动顺序串成双向链表（槽位下标），plist 按启动顺序列出，摘除为 O(1)
+// - 另有一张按系统 PID 索引的开放寻址哈希表，回收子进程时由系统 PID 找到表项
+static Process* process_slots = NULL;
+static int process_capacity = 0;
 static int process_count = 0;
-static int next_pid = 1;
+static int* free_slots = NULL;        // 空闲槽位的环形队列
+static int free_head = 0;
+static int free_count = 0;
+static int first_process = -1;        // 启动顺序链表的头尾（槽位下标）
+static int last_process = -1;
+static int* system_pid_index = NULL;  // 系统 PID -> 槽位下标，空位为 -1
+static size_t system_pid_mask = 0;    // 哈希表大小 - 1（大小为 2 的幂）
+static SpawnBackend spawn_backend = SPAWN_BACKEND_POSIX_SPAWN;
+
+// ruby(reaper)：回收线程。每个子进程登记时打开一个 pidfd 加入 epoll，子进程退出时 pidfd 可读，
+// 回收线程 wait4 取得退出状态和资源使用、记入退出记录并释放槽位，CLI 线程不需要等待。
+// 内核不支持 pidfd 时，回收线程每 REAPER_POLL_MS 毫秒对这些进程 waitpid(WNOHANG) 一次。
+// 进程表由 process_lock 保护；槽位释放时广播 process_released（stop 在上面等待）
+// ruby(plog)：--capture 启动时子进程的标准输出 / 错误接到管道，管道读端也加入同一个 epoll，
+// 由回收线程读进每个进程固定大小的环形缓冲区（写满覆盖最旧的内容，子进程从不因此阻塞）。
+// 进程退出后缓冲区随退出记录保留，plog 仍可查看
+#define REAPER_POLL_MS 100
+#define REAPER_BATCH 64
+#define EXIT_HISTORY 16               // 保留的最近退出记录数
+#define REAPER_OUTPUT_TAG (1ULL << 32) // epoll 事件数据：带这个标记的是输出管道，其余是 pidfd
+#define OUTPUT_READ_SIZE 16384        // 每次从输出管道读取的字节数
+#define OUTPUT_READS_PER_EVENT 4      // 每个事件最多读几次，避免一个进程的大量输出拖慢其他进程
+#define STOP_KILL_WAIT_MS 1000        // 发出 SIGKILL 后最多再等待的时间
+#define STOP_POLL_MS 10               // 没有回收线程时 stop 轮询子进程的间隔
+
+typedef struct {
+    int pid;                          // NeuMiniOS PID
+    pid_t system_pid;
+    char name[MAX_PROCESS_NAME];
+    int status;                       // wait4 得到的状态，-1 表示无法取得
+    int reported;                     // 1=已经提示过用户
+    StopState stop_state;             // 被 stop 时的进度，report_process_events 据此报告 stop 的结果
+    ProcessUsage usage;               // 退出时的资源使用（rusage）
+    OutputRing* output;               // 捕获的输出（没有捕获为 NULL）
+} ExitRecord;
+
+static pthread_mutex_t process_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t process_released;   // 使用 CLOCK_MONOTONIC，见 init_release_cond
+static pthread_once_t release_cond_once = PTHREAD_ONCE_INIT;
+static pthread_t reaper_thread;
+static int reaper_running = 0;
+static int reaper_stopping = 0;
+static int reaper_epoll = -1;
+static int reaper_wake = -1;          // eventfd：唤醒回收线程（新的无 pidfd 进程 / 退出）
+static int unwatched_count = 0;       // 没有 pidfd、需要轮询的进程数
+static ExitRecord exit_history[EXIT_HISTORY];
+static int exit_history_next = 0;
+static int exit_history_count = 0;
+static int stop_grace_ms = DEFAULT_STOP_GRACE_MS;
+static int stopping_count = 0;        // 处于 STOP_TERM_SENT / STOP_KILL_SENT 的进程数（回收线程据此计时）
+static int capture_output = 0;
+static size_t output_ring_size = DEFAULT_OUTPUT_RING_SIZE;
+static int child_input_fd = -1;       // 没有重定向时子进程的标准输入，-1=继承终端
+
+// ruby(jobs)：运行队列。同时运行的进程数达到上限（--max-running，默认为进程表容量）时，
+// run 不再报错，而是把作业放进按优先级排序的二叉堆（同优先级按提交顺序）。
+// 回收线程释放槽位后立即从堆顶取作业启动，启动和失败的结果记为提示，CLI 在下一个提示符前显示。
+// 排队的作业持有一个可执行文件的 fd（memfd 的副本，或打开的临时文件），启动后关闭。
+// CLI 线程和回收线程都可能启动子进程，launch_lock 保证同一时刻只有一个启动（zygote 连接不能并发使用）
+#define NOTICE_HISTORY 32             // 等待显示的提示条数
+#define NOTICE_LENGTH 160
+
+typedef struct {
+    int id;                           // 作业号（jobs --cancel 使用）
+    char name[MAX_PROCESS_NAME];
+    int exec_fd;                      // 作业持有的可执行文件 fd
+    RunOptions options;
+    unsigned long sequence;           // 提交顺序，同优先级先提交先启动
+    struct timespec submit_time;
+} Job;
+
+static pthread_mutex_t launch_lock = PTHREAD_MUTEX_INITIALIZER;
+static Job* job_heap = NULL;
+static int job_count = 0;
+static int job_heap_capacity = 0;
+static int next_job_id = 1;
+static unsigned long job_sequence = 0;
+static int starting_count = 0;        // 已经从队列取出（或直接 run）但还没登记的启动数
+static int max_running = 0;           // 0 表示与进程表容量相同
+static char notices[NOTICE_HISTORY][NOTICE_LENGTH];
+static int notice_next = 0;
+static int notice_count = 0;
 
-// ruby(plist/run/stop)：全局链表维护 NeuMiniOS 进程表，process_count 控制容量，next_pid 分配自增 PID
-static Process* find_process(int pid, Process** out_prev) {
-    Process* prev = NULL;
-    Process* curr = process_list;
-    while (curr) {
-        if (curr->pid == pid) {
-            if (out_prev) *out_prev = prev;
-            return curr;
+// stop 按单调时钟计算等待截止时间，不受系统时间调整影响
+static void init_release_cond(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&process_released, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static size_t hash_system_pid(pid_t system_pid) {
+    return ((size_t)(unsigned int)system_pid * 2654435761u) & system_pid_mask;
+}
+
+static void index_system_pid(int slot) {
+    size_t i = hash_system_pid(process_slots[slot].system_pid);
+    while (system_pid_index[i] >= 0) {
+        i = (i + 1) & system_pid_mask;
+    }
+    system_pid_index[i] = slot;
+}
+
+// 线性探测表的删除：把后面同一探测链上的项向前移，不需要墓碑
+static void unindex_system_pid(int slot) {
+    size_t i = hash_system_pid(process_slots[slot].system_pid);
+    while (system_pid_index[i] != slot) {
+        if (system_pid_index[i] < 0) return;
+        i = (i + 1) & system_pid_mask;
+    }
+    system_pid_index[i] = -1;
+
+    size_t j = i;
+    while (1) {
+        j = (j + 1) & system_pid_mask;
+        if (system_pid_index[j] < 0) break;
+        size_t home = hash_system_pid(process_slots[system_pid_index[j]].system_pid);
+        // home 不在 (i, j] 之间时，这一项可以移到空出来的 i
+        if (((j - home) & system_pid_mask) >= ((j - i) & system_pid_mask)) {
+            system_pid_index[i] = system_pid_index[j];
+            system_pid_index[j] = -1;
+            i = j;
         }
-        prev = curr;
-        curr = curr->next;
     }
-    if (out_prev) *out_prev = NULL;
+}
+
+// 按 NeuMiniOS PID 查找运行中的进程，旧 PID（槽位已被重新使用或已释放）返回 NULL
+static Process* find_process(int pid) {
+    if (pid <= 0 || process_capacity == 0) return NULL;
+    int slot = (pid - 1) % process_capacity;
+    unsigned int generation = (unsigned int)((pid - 1) / process_capacity);
+    Process* process = &process_slots[slot];
+    return (process->status == 1 && process->generation == generation) ? process : NULL;
+}
+
+// 按系统 PID 查找运行中的进程（回收子进程时使用）
+static Process* find_process_by_system_pid(pid_t system_pid) {
+    if (!system_pid_index) return NULL;
+    size_t i = hash_system_pid(system_pid);
+    while (system_pid_index[i] >= 0) {
+        Process* process = &process_slots[system_pid_index[i]];
+        if (process->system_pid == system_pid) return process;
+        i = (i + 1) & system_pid_mask;
+    }
     return NULL;
 }
 
-// 初始化进程表
-void init_process_table(void) {
-    // 启动时确保链表为空
-    Process* curr = process_list;
-    while (curr) {
-        Process* next = curr->next;
-        free(curr);
-        curr = next;
+// 释放进程表占用的内存（回收线程已经停止）
+static void free_process_table(void) {
+    for (int slot = first_process; slot >= 0; slot = process_slots[slot].next) {
+        if (process_slots[slot].pidfd >= 0) close(process_slots[slot].pidfd);
+        if (process_slots[slot].output_fd >= 0) close(process_slots[slot].output_fd);
+        destroy_output_ring(process_slots[slot].output);
+    }
+    for (int i = 0; i < exit_history_count; i++) {
+        destroy_output_ring(exit_history[i].output);
+        exit_history[i].output = NULL;
     }
-    process_list = NULL;
+    exit_history_next = exit_history_count = 0;
+    free(process_slots);
+    free(free_slots);
+    free(system_pid_index);
+    process_slots = NULL;
+    free_slots = NULL;
+    system_pid_index = NULL;
+    process_capacity = 0;
     process_count = 0;
-    next_pid = 1;
+    free_count = 0;
+    unwatched_count = 0;
+    stopping_count = 0;
+    first_process = last_process = -1;
+}
+
+static int open_pidfd(pid_t system_pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, system_pid, 0);
+#else
+    (void)system_pid;
+    errno = ENOSYS;
+    return -1;
+#endif
 }
 
-// 读取二进制文件到内存（用于从Disk Image中提取）
-unsigned char* read_file(const char *path, size_t *out_size) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return NULL;
+static void wake_reaper(void) {
+    uint64_t one = 1;
+    if (reaper_wake >= 0) {
+        ssize_t ignored = write(reaper_wake, &one, sizeof(one));
+        (void)ignored;
+    }
+}
 
-    fseek(f, 0, SEEK_END);
-    *out_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
 
-    unsigned char *buffer = malloc(*out_size);
-    if (!buffer) {
-        fclose(f);
-        return NULL;
+// 从现在起 timeout_ms 毫秒的截止时间（CLOCK_MONOTONIC，不受系统时间调整影响）
+static void deadline_after(int timeout_ms, struct timespec* deadline) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
     }
+}
 
-    fread(buffer, 1, *out_size, f);
-    fclose(f);
-    return buffer;
+// 距截止时间还有多少毫秒（向上取整），已经到达返回0
+static long ms_until(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long ns = (long long)(deadline->tv_sec - now.tv_sec) * 1000000000LL + (deadline->tv_nsec - now.tv_nsec);
+    return ns > 0 ? (long)((ns + 999999LL) / 1000000LL) : 0;
 }
 
-// 将内存中的二进制文件写入临时文件并设为可执行
-int write_file(const char *path, unsigned char *data, size_t size) {
-    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (fd < 0) return -1;
+// 记一条提示，由 report_process_events 在下一个提示符前显示。调用者持有 process_lock
+static void push_notice(const char* message) {
+    snprintf(notices[notice_next], NOTICE_LENGTH, "%s", message);
+    notice_next = (notice_next + 1) % NOTICE_HISTORY;
+    if (notice_count < NOTICE_HISTORY) notice_count++;
+}
 
-    write(fd, data, size);
-    close(fd);
+// 记录一次退出，usage 为 NULL 时（拿不到 rusage）资源使用记为 0；捕获的输出转交给退出记录
+// 记录先标为未提示；stop 自己报告结果后标记为已提示，其余的留给 report_process_events
+static void record_exit(Process* process, int status, const struct rusage* usage) {
+    ExitRecord* record = &exit_history[exit_history_next];
+    destroy_output_ring(record->output);
+    record->output = process->output;
+    process->output = NULL;
+    record->pid = process->pid;
+    record->system_pid = process->system_pid;
+    snprintf(record->name, sizeof(record->name), "%s", process->name);
+    record->status = status;
+    record->reported = 0;
+    record->stop_state = process->stop_state;
+    memset(&record->usage, 0, sizeof(record->usage));
+    if (usage) {
+        record->usage.user_seconds = (double)usage->ru_utime.tv_sec + (double)usage->ru_utime.tv_usec / 1e6;
+        record->usage.system_seconds = (double)usage->ru_stime.tv_sec + (double)usage->ru_stime.tv_usec / 1e6;
+        record->usage.max_rss_kb = usage->ru_maxrss;   // Linux 上单位为 KB
+        record->usage.voluntary_switches = usage->ru_nvcsw;
+        record->usage.involuntary_switches = usage->ru_nivcsw;
+    }
+    record->usage.uptime_seconds = seconds_since(&process->start_time);
+    record->usage.state = 'X';
+    exit_history_next = (exit_history_next + 1) % EXIT_HISTORY;
+    if (exit_history_count < EXIT_HISTORY) exit_history_count++;
+}
+
+static void release_process(Process* process);
+
+// 把输出管道中现有的内容读进环形缓冲区；max_reads 为 0 时一直读到管道为空
+// 写端全部关闭（读到 EOF）时关闭读端。调用者持有 process_lock
+static void drain_output(Process* process, int max_reads) {
+    char buffer[OUTPUT_READ_SIZE];
+    for (int reads = 0; process->output_fd >= 0 && (max_reads == 0 || reads < max_reads); reads++) {
+        ssize_t n = read(process->output_fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            output_ring_append(process->output, buffer, (size_t)n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || errno != EAGAIN) {
+            close(process->output_fd);   // 关闭后自动从 epoll 中移除
+            process->output_fd = -1;
+        }
+        break;
+    }
+}
+
+// 子进程已退出时回收它并释放槽位，返回1；仍在运行返回0。调用者持有 process_lock
+static int try_reap(Process* process) {
+    int status = 0;
+    struct rusage usage;
+    pid_t result = wait4(process->system_pid, &status, WNOHANG, &usage);
+    if (result == 0 || (result < 0 && errno == EINTR)) return 0;
+    // 退出前写进管道的输出还没读完
+    drain_output(process, 0);
+    // ECHILD：不是本进程的子进程（zygote 退回普通启动时），拿不到退出状态
+    if (result == process->system_pid) {
+        record_exit(process, status, &usage);
+    } else {
+        record_exit(process, -1, NULL);
+    }
+    release_process(process);
+    pthread_cond_broadcast(&process_released);
+    return 1;
+}
+
+static void dispatch_jobs(void);
+
+// 回收线程最多等待多久就要处理下一个 stop 截止时间（毫秒），没有进行中的 stop 返回-1。调用者持有 process_lock
+static int next_stop_timeout(void) {
+    long timeout = -1;
+    for (int slot = first_process; slot >= 0 && stopping_count > 0; slot = process_slots[slot].next) {
+        const Process* process = &process_slots[slot];
+        if (process->stop_state != STOP_TERM_SENT && process->stop_state != STOP_KILL_SENT) continue;
+        long remaining = ms_until(&process->stop_deadline);
+        if (timeout < 0 || remaining < timeout) timeout = remaining;
+    }
+    return (int)timeout;
+}
+
+// 处理到期的 stop：宽限期内没有退出的改发 SIGKILL；SIGKILL 之后仍未退出的记一条错误，不再等待。调用者持有 process_lock
+static void enforce_stop_deadlines(void) {
+    for (int slot = first_process; slot >= 0 && stopping_count > 0; slot = process_slots[slot].next) {
+        Process* process = &process_slots[slot];
+        if (process->stop_state != STOP_TERM_SENT && process->stop_state != STOP_KILL_SENT) continue;
+        if (ms_until(&process->stop_deadline) > 0) continue;
+        if (process->stop_state == STOP_TERM_SENT) {
+            kill(process->system_pid, SIGKILL);
+            process->stop_state = STOP_KILL_SENT;
+            deadline_after(STOP_KILL_WAIT_MS, &process->stop_deadline);
+            continue;
+        }
+        char message[NOTICE_LENGTH + MAX_PROCESS_NAME];   // push_notice 截断到 NOTICE_LENGTH
+        snprintf(message, sizeof(message), "Error: Process %d (%s) did not exit after SIGKILL",
+                 process->pid, process->name);
+        push_notice(message);
+        process->stop_state = STOP_ABANDONED;
+        stopping_count--;
+    }
+}
 
-    // 设为可执行
-    chmod(path, 0755);
+static void* reaper_main(void* arg) {
+    (void)arg;
+    struct epoll_event events[REAPER_BATCH];
+    while (1) {
+        pthread_mutex_lock(&process_lock);
+        int stopping = reaper_stopping;
+        int timeout = unwatched_count > 0 ? REAPER_POLL_MS : -1;
+        int stop_timeout = stopping_count > 0 ? next_stop_timeout() : -1;
+        if (stop_timeout >= 0 && (timeout < 0 || stop_timeout < timeout)) timeout = stop_timeout;
+        pthread_mutex_unlock(&process_lock);
+        if (stopping) break;
+
+        int n = epoll_wait(reaper_epoll, events, REAPER_BATCH, timeout);
+        if (n < 0 && errno != EINTR) break;
+
+        pthread_mutex_lock(&process_lock);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == 0) {
+                uint64_t value;
+                ssize_t ignored = read(reaper_wake, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+            // 进程被回收之前系统 PID 不会被重新分配，按系统 PID 找到的一定是同一个进程
+            uint64_t data = events[i].data.u64;
+            Process* process = find_process_by_system_pid((pid_t)(data & ~REAPER_OUTPUT_TAG));
+            if (!process) continue;
+            if (data & REAPER_OUTPUT_TAG) {
+                drain_output(process, OUTPUT_READS_PER_EVENT);
+            } else {
+                try_reap(process);
+            }
+        }
+        if (unwatched_count > 0) {
+            int slot = first_process;
+            while (slot >= 0) {
+                int next = process_slots[slot].next;
+                if (process_slots[slot].pidfd < 0) try_reap(&process_slots[slot]);
+                slot = next;
+            }
+        }
+        // 先回收再检查截止时间：恰好在宽限期结束时退出的进程不会再收到 SIGKILL
+        if (stopping_count > 0) enforce_stop_deadlines();
+        pthread_mutex_unlock(&process_lock);
+        // 刚释放的槽位交给排队的作业
+        dispatch_jobs();
+    }
+    return NULL;
+}
+
+// 启动回收线程，失败时返回-1（之后 stop 自己等待子进程，已退出的程序在 stop 或退出时才回收）
+static int start_reaper(void) {
+    reaper_epoll = epoll_create1(EPOLL_CLOEXEC);
+    reaper_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = 0;
+    if (reaper_epoll >= 0 && reaper_wake >= 0 &&
+        epoll_ctl(reaper_epoll, EPOLL_CTL_ADD, reaper_wake, &event) == 0) {
+        reaper_stopping = 0;
+        if (pthread_create(&reaper_thread, NULL, reaper_main, NULL) == 0) {
+            reaper_running = 1;
+            return 0;
+        }
+    }
+    if (reaper_epoll >= 0) close(reaper_epoll);
+    if (reaper_wake >= 0) close(reaper_wake);
+    reaper_epoll = reaper_wake = -1;
+    return -1;
+}
+
+static void stop_reaper(void) {
+    if (!reaper_running) return;
+    pthread_mutex_lock(&process_lock);
+    reaper_stopping = 1;
+    pthread_mutex_unlock(&process_lock);
+    wake_reaper();
+    pthread_join(reaper_thread, NULL);
+    close(reaper_epoll);
+    close(reaper_wake);
+    reaper_epoll = reaper_wake = -1;
+    reaper_running = 0;
+}
+
+/*
+ * 初始化进程表
+ *
+ * @param capacity  最多同时运行的进程数（1 ~ MAX_PROCESS_LIMIT）
+ *
+ * @return 成功返回0，参数错误或内存不足返回-1
+ */
+int init_process_table(int capacity) {
+    pthread_once(&release_cond_once, init_release_cond);
+    // 启动时确保进程表为空
+    stop_reaper();
+    free_process_table();
+    if (capacity <= 0 || capacity > MAX_PROCESS_LIMIT) return -1;
+
+    size_t index_size = 1;
+    while (index_size < (size_t)capacity * 2) index_size <<= 1;
+
+    process_slots = (Process*)calloc((size_t)capacity, sizeof(Process));
+    free_slots = (int*)malloc((size_t)capacity * sizeof(int));
+    system_pid_index = (int*)malloc(index_size * sizeof(int));
+    if (!process_slots || !free_slots || !system_pid_index) {
+        free_process_table();
+        return -1;
+    }
+
+    process_capacity = capacity;
+    system_pid_mask = index_size - 1;
+    for (size_t i = 0; i < index_size; i++) {
+        system_pid_index[i] = -1;
+    }
+    for (int i = 0; i < capacity; i++) {
+        process_slots[i].prev = process_slots[i].next = -1;
+        process_slots[i].pidfd = process_slots[i].output_fd = -1;
+        free_slots[i] = i;
+    }
+    free_head = 0;
+    free_count = capacity;
+
+    if (start_reaper() != 0) {
+        printf("Warning: Failed to start process reaper, exited programs are reclaimed on stop\n");
+    }
     return 0;
 }
 
-// 运行提取出的程序
-void run_program(const char *path) {
-    pid_t pid = fork();
-    if (pid == 0) {
-        // 子进程：运行程序
-        execl(path, path, (char *)NULL);
-        perror("execl failed");
-        _exit(1);
-    } else if (pid > 0) {
-        // 父进程：记录PID
-        printf("[INFO] Process started with system PID: %d\n", pid);
+int get_process_capacity(void) {
+    return process_capacity;
+}
+
+// ruby(run-memfd)：程序内容直接写进匿名内存文件并加封印，通过 fd 执行，不在 /tmp 留下任何文件
+// 创建用于执行的匿名内存文件，失败返回 -1（内核不支持 memfd 时调用者退回到临时文件）
+int create_exec_memfd(const char* program_name) {
+    int fd = -1;
+#ifdef MFD_EXEC
+    // 新内核可以通过 sysctl 默认禁止执行 memfd，显式声明可执行；老内核不认识这个标志时再去掉重试
+    fd = memfd_create(program_name, MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_EXEC);
+#endif
+    if (fd < 0) {
+        fd = memfd_create(program_name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    }
+    return fd;
+}
+
+// 写完内容后加封印：之后内容不能再被修改、截断或扩展，exec 看到的就是写入的字节
+int seal_exec_memfd(int fd) {
+    return fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+}
+
+// 从空闲队列取一个槽位登记进程，挂到启动顺序链表尾部，并交给回收线程监视
+// output_fd / output 为输出管道的读端和缓冲区（不捕获时为 -1 / NULL），由进程表接管
+// 调用者持有 process_lock，并已检查过容量
+static int register_process(const char* program_name, pid_t system_pid, int output_fd, OutputRing* output,
+                            const RunOptions* options) {
+    int slot = free_slots[free_head];
+    free_head = (free_head + 1) % process_capacity;
+    free_count--;
+
+    Process* process = &process_slots[slot];
+    // 代数用完时回到 0（PID 不能超过 INT_MAX）
+    if (process->generation > (unsigned int)((INT_MAX - 1 - slot) / process_capacity)) {
+        process->generation = 0;
+    }
+    process->pid = (int)(process->generation * (unsigned int)process_capacity) + slot + 1;
+    process->system_pid = system_pid;
+    snprintf(process->name, sizeof(process->name), "%s", program_name);
+    process->options = *options;
+    process->status = 1;
+    process->stop_state = STOP_NONE;
+    clock_gettime(CLOCK_MONOTONIC, &process->start_time);
+    process->prev = last_process;
+    process->next = -1;
+    if (last_process >= 0) {
+        process_slots[last_process].next = slot;
     } else {
-        perror("fork failed");
+        first_process = slot;
     }
+    last_process = slot;
+    index_system_pid(slot);
+    process_count++;
+
+    // 子进程可能已经退出：僵尸进程同样能打开 pidfd，并且立即可读
+    process->pidfd = reaper_running ? open_pidfd(system_pid) : -1;
+    if (process->pidfd >= 0) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u64 = (uint64_t)system_pid;
+        if (epoll_ctl(reaper_epoll, EPOLL_CTL_ADD, process->pidfd, &event) != 0) {
+            close(process->pidfd);
+            process->pidfd = -1;
+        }
+    }
+    if (process->pidfd < 0 && reaper_running) {
+        unwatched_count++;
+        wake_reaper();
+    }
+
+    process->output = output;
+    process->output_fd = output_fd;
+    if (output_fd >= 0) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u64 = REAPER_OUTPUT_TAG | (uint64_t)system_pid;
+        epoll_ctl(reaper_epoll, EPOLL_CTL_ADD, output_fd, &event);
+    }
+    return process->pid;
+}
+
+// 释放进程占用的槽位：摘出启动顺序链表和系统 PID 索引，代数加 1 使旧 PID 失效，槽位回到空闲队列尾部
+static void release_process(Process* process) {
+    int slot = (int)(process - process_slots);
+    if (process->prev >= 0) process_slots[process->prev].next = process->next; else first_process = process->next;
+    if (process->next >= 0) process_slots[process->next].prev = process->prev; else last_process = process->prev;
+    unindex_system_pid(slot);
+    if (process->pidfd >= 0) {
+        close(process->pidfd);   // 关闭后自动从 epoll 中移除
+        process->pidfd = -1;
+    } else if (reaper_running) {
+        unwatched_count--;
+    }
+    if (process->output_fd >= 0) {
+        close(process->output_fd);
+        process->output_fd = -1;
+    }
+    destroy_output_ring(process->output);
+    process->output = NULL;
+    remove_run_cgroup(process->options.limits.cgroup);
+    if (process->stop_state == STOP_TERM_SENT || process->stop_state == STOP_KILL_SENT) stopping_count--;
+    process->stop_state = STOP_NONE;
+
+    process->status = 0;
+    process->generation++;
+    process->prev = process->next = -1;
+    free_slots[(free_head + free_count) % process_capacity] = slot;
+    free_count++;
+    process_count--;
+}
+
+// 选择启动后端（引导时由 --spawn 设置）
+void set_spawn_backend(SpawnBackend backend) {
+    spawn_backend = backend;
+}
+
+SpawnBackend get_spawn_backend(void) {
+    return spawn_backend;
 }
 
-// 创建新进程（run命令）
-int create_process(const char *program_name, const char *program_path) {
-    // 1. 检查容量
-    if (process_count >= MAX_PROCESSES) {
-        printf("[ERROR] Process table full (max %d processes)\n", MAX_PROCESSES);
+// fork 后端：用一个 O_CLOEXEC 管道等待 exec 完成，exec 成功时管道被内核关闭，父进程读到 EOF；
+// 失败时子进程把 errno 写进管道
+static pid_t launch_with_fork(char* const argv[], const char* program_path, int exec_fd, const ChildStdio* stdio,
+                              const ProcessLimits* limits, int* error) {
+    int status_pipe[2];
+    if (pipe2(status_pipe, O_CLOEXEC) != 0) {
+        *error = errno;
         return -1;
     }
 
-    size_t size;
-    unsigned char *data = read_file(program_path, &size);
-    if (!data) {
-        printf("[ERROR] Could not read program: %s\n", program_path);
+    pid_t system_pid = fork();
+    if (system_pid == 0) {
+        // 子进程
+        close(status_pipe[0]);
+        redirect_child_stdio(stdio);
+        if (!limits || apply_process_limits(limits) == 0) {
+            if (exec_fd >= 0) {
+                fexecve(exec_fd, argv, environ);
+            } else {
+                execv(program_path, argv);
+            }
+        }
+        int child_error = errno;
+        ssize_t ignored = write(status_pipe[1], &child_error, sizeof(child_error));
+        (void)ignored;
+        _exit(127);
+    }
+    close(status_pipe[1]);
+    if (system_pid < 0) {
+        *error = errno;
+        close(status_pipe[0]);
         return -1;
     }
 
-    // 3. 写入临时文件
-    char temp_path[] = "/tmp/neumini_XXXXXX";
-    int fd = mkstemp(temp_path);
-    if (fd == -1) {
-        free(data);
+    int child_error = 0;
+    ssize_t n;
+    do {
+        n = read(status_pipe[0], &child_error, sizeof(child_error));
+    } while (n < 0 && errno == EINTR);
+    close(status_pipe[0]);
+
+    if (n == (ssize_t)sizeof(child_error)) {
+        // exec 失败：子进程已经退出，直接回收
+        waitpid(system_pid, NULL, 0);
+        *error = child_error;
         return -1;
     }
-    close(fd);
+    return system_pid;
+}
+
+// posix_spawn 后端：glibc 用 clone(CLONE_VM | CLONE_VFORK) 实现，不复制父进程的页表，
+// 启动耗时与磁盘镜像占用的堆大小无关；exec 失败时错误码直接由 posix_spawn 返回
+// memfd 通过 /proc/self/fd/N 执行（子进程在 exec 之前仍持有这个 fd）
+static pid_t launch_with_posix_spawn(char* const argv[], const char* program_path, int exec_fd, const ChildStdio* stdio,
+                                     int* error) {
+    char fd_path[64];
+    if (exec_fd >= 0) {
+        snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", exec_fd);
+        program_path = fd_path;
+    }
 
-    if (write_file(temp_path, data, size) != 0) {
-        free(data);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_t* actions_ptr = NULL;
+    if (stdio && (stdio->input >= 0 || stdio->output >= 0 || stdio->error >= 0)) {
+        posix_spawn_file_actions_init(&actions);
+        if (stdio->input >= 0) posix_spawn_file_actions_adddup2(&actions, stdio->input, STDIN_FILENO);
+        if (stdio->output >= 0) posix_spawn_file_actions_adddup2(&actions, stdio->output, STDOUT_FILENO);
+        if (stdio->error >= 0) posix_spawn_file_actions_adddup2(&actions, stdio->error, STDERR_FILENO);
+        actions_ptr = &actions;
+    }
+
+    pid_t system_pid = -1;
+    int result = posix_spawn(&system_pid, program_path, actions_ptr, NULL, argv, environ);
+    if (actions_ptr) posix_spawn_file_actions_destroy(actions_ptr);
+    if (result != 0) {
+        *error = result;
         return -1;
     }
+    return system_pid;
+}
 
-    free(data);
+/*
+ * 启动一个子进程并等到 exec 完成（exec_fd >= 0 时执行该 fd，否则执行 program_path）
+ *
+ * posix_spawn 后端找不到 /proc（memfd 路径无法打开）时退回到 fork；
+ * posix_spawn 不能在 exec 之前设置资源限制、nice 和 CPU 亲和性，设置了其中任何一项时同样使用 fork。
+ *
+ * @param stdio  子进程的标准输入 / 输出 / 错误，NULL 表示全部继承终端
+ * @param limits  子进程 exec 之前设置的资源限制、nice 和 CPU 亲和性，NULL 表示不设置
+ * @param error  失败时返回 errno
+ *
+ * @return 子进程的系统 PID，失败返回-1
+ */
+pid_t launch_program(const char* program_name, const char* program_path, int exec_fd,
+                     SpawnBackend backend, const ChildStdio* stdio, const ProcessLimits* limits, int* error) {
+    char* const argv[] = {(char*)program_name, NULL};
 
-    // 创建子进程
-    pid_t system_pid = fork();
-    if (system_pid == 0) {
-        // 子进程
-        execl(temp_path, program_name, (char *)NULL);
-        perror("[ERROR] execl failed");
-        _exit(1);
-    } else if (system_pid > 0) {
-        // 父进程：记录进程信息
-        Process* node = (Process*)malloc(sizeof(Process));
-        if (!node) {
-            perror("[ERROR] malloc failed");
+    if (limits && !has_process_limits(limits)) limits = NULL;
+    if (backend == SPAWN_BACKEND_POSIX_SPAWN && !limits) {
+        pid_t system_pid = launch_with_posix_spawn(argv, program_path, exec_fd, stdio, error);
+        if (system_pid > 0 || exec_fd < 0 || (*error != ENOENT && *error != ENOSYS)) {
+            return system_pid;
+        }
+    }
+    return launch_with_fork(argv, program_path, exec_fd, stdio, limits, error);
+}
+
+// 在子进程中（fork 之后、exec 之前）把 stdio 中的 fd 接到标准输入 / 输出 / 错误
+void redirect_child_stdio(const ChildStdio* stdio) {
+    if (!stdio) return;
+    if (stdio->input >= 0) dup2(stdio->input, STDIN_FILENO);
+    if (stdio->output >= 0) dup2(stdio->output, STDOUT_FILENO);
+    if (stdio->error >= 0) dup2(stdio->error, STDERR_FILENO);
+}
+
+void init_process_limits(ProcessLimits* limits) {
+    memset(limits, 0, sizeof(*limits));
+    limits->address_space = LIMIT_UNSET;
+    limits->cpu_seconds = LIMIT_UNSET;
+    limits->open_files = LIMIT_UNSET;
+    limits->core_size = LIMIT_UNSET;
+}
+
+void init_run_options(RunOptions* options) {
+    memset(options, 0, sizeof(*options));
+    init_process_limits(&options->limits);
+}
+
+// 把 "0,2-3" 形式的 CPU 列表解析为 cpu_set_t，格式错误或超出 CPU_SETSIZE 返回-1
+static int parse_cpu_list(const char* cpus, cpu_set_t* set) {
+    CPU_ZERO(set);
+    const char* p = cpus;
+    if (*p == '\0') return -1;
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return -1;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) return -1;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET((int)cpu, set);
+        }
+        if (*end == ',') {
+            end++;
+            if (*end == '\0') return -1;
+        } else if (*end != '\0') {
             return -1;
         }
-        node->pid = next_pid++;
-        node->system_pid = system_pid;
-        strcpy(node->name, program_name);
-        node->status = 1;
-        node->next = NULL;
+        p = end;
+    }
+    return 0;
+}
+
+// 检查 CPU 列表的格式（run -c），正确返回0
+int validate_cpu_list(const char* cpus) {
+    cpu_set_t set;
+    return parse_cpu_list(cpus, &set);
+}
+
+// 是否设置了任何资源限制、cgroup、nice 或 CPU 亲和性
+int has_process_limits(const ProcessLimits* limits) {
+    return limits->address_space != LIMIT_UNSET || limits->cpu_seconds != LIMIT_UNSET ||
+           limits->open_files != LIMIT_UNSET || limits->core_size != LIMIT_UNSET || limits->cgroup[0] != '\0' ||
+           limits->has_nice || limits->cpus[0] != '\0';
+}
+
+/*
+ * 在子进程中（fork 之后、exec 之前）加入 cgroup，设置 CPU 亲和性、nice 和资源限制，zygote 启动的子进程同样调用
+ *
+ * 先加入 cgroup：打开 cgroup.procs 需要一个 fd，之后 RLIMIT_NOFILE 可能已经很小
+ *
+ * @return 成功返回0，失败返回-1（errno 说明原因，例如超过硬限制或无权调低 nice 时为 EPERM / EACCES）
+ */
+int apply_process_limits(const ProcessLimits* limits) {
+    const int resources[] = {RLIMIT_AS, RLIMIT_CPU, RLIMIT_NOFILE, RLIMIT_CORE};
+    const long long values[] = {limits->address_space, limits->cpu_seconds, limits->open_files, limits->core_size};
+    if (limits->cgroup[0] && join_cgroup(limits->cgroup) != 0) return -1;
+    if (limits->cpus[0]) {
+        cpu_set_t set;
+        if (parse_cpu_list(limits->cpus, &set) != 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) return -1;
+    }
+    if (limits->has_nice && setpriority(PRIO_PROCESS, 0, limits->nice) != 0) return -1;
+    for (size_t i = 0; i < sizeof(resources) / sizeof(resources[0]); i++) {
+        if (values[i] == LIMIT_UNSET) continue;
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = (rlim_t)values[i];
+        // CPU 时间：到软限制先收到 SIGXCPU（可以处理），1 秒后到硬限制再被 SIGKILL
+        if (resources[i] == RLIMIT_CPU) limit.rlim_max = limit.rlim_cur + 1;
+        if (setrlimit(resources[i], &limit) != 0) return -1;
+    }
+    return 0;
+}
+
+// 记一条提示，由 report_process_events 在下一个提示符前显示；announce=1 时直接输出
+// announce=0 时调用者不能持有 process_lock
+static void emit_notice(int announce, const char* format, ...) {
+    char message[NOTICE_LENGTH];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (announce) {
+        printf("%s\n", message);
+        return;
+    }
+    pthread_mutex_lock(&process_lock);
+    push_notice(message);
+    pthread_mutex_unlock(&process_lock);
+}
+
+// 同时运行的进程数上限
+static int running_limit(void) {
+    return (max_running > 0 && max_running < process_capacity) ? max_running : process_capacity;
+}
 
-        // 追加到链表尾部，保持插入顺序
-        if (!process_list) {
-            process_list = node;
+/*
+ * 启动程序并登记到进程表。调用者已在 process_lock 下把 starting_count 加 1（预留了一个名额）
+ *
+ * @param input_fd  子进程的标准输入（管道读端），-1 表示继承终端
+ * @param output_fd 子进程的标准输出（管道写端），-1 表示终端或 --capture 的输出缓冲区
+ * @param job_id    从队列启动时为作业号，直接 run 为 0
+ * @param announce  1=结果直接输出（CLI 线程），0=记为提示（回收线程）
+ *
+ * @return 进程的 NeuMiniOS PID，失败返回-1
+ */
+static int start_job(const char* program_name, const char* program_path, int exec_fd, const RunOptions* run_options,
+                     int input_fd, int output_fd, int job_id, int announce) {
+    // --cgroup：每次 run 一个新的 cgroup，子进程 exec 之前加入
+    RunOptions options_copy = *run_options;
+    const RunOptions* options = &options_copy;
+    if (cgroup_enabled() && create_run_cgroup(options_copy.limits.cgroup, sizeof(options_copy.limits.cgroup)) != 0) {
+        emit_notice(announce, "Warning: Cannot create a cgroup for '%s': %s", program_name, strerror(errno));
+    }
+
+    // --capture：输出接到管道，读端非阻塞，交给回收线程读取
+    int output_pipe[2] = {-1, -1};
+    OutputRing* output = NULL;
+    if (capture_output && reaper_running) {
+        output = create_output_ring(output_ring_size);
+        if (!output || pipe2(output_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+            emit_notice(announce, "Warning: Cannot capture output of '%s', it will write to the terminal", program_name);
+            destroy_output_ring(output);
+            output = NULL;
+            output_pipe[0] = output_pipe[1] = -1;
+        } else {
+            // 子进程一端与写终端时一样保持阻塞：回收线程来不及读时子进程短暂等待，而不是收到 EAGAIN
+            fcntl(output_pipe[1], F_SETFL, 0);
+        }
+    }
+
+    // 标准输出接到管道时只有标准错误进入输出缓冲区
+    ChildStdio stdio;
+    stdio.input = input_fd >= 0 ? input_fd : child_input_fd;
+    stdio.output = output_fd >= 0 ? output_fd : output_pipe[1];
+    stdio.error = output_pipe[1];
+
+    // 启用 zygote 时由引导阶段分出的小进程代为 fork / exec，启动耗时与本进程的堆大小无关
+    int error = 0;
+    pthread_mutex_lock(&launch_lock);
+    pid_t system_pid = zygote_running()
+        ? zygote_launch(program_name, program_path, exec_fd, &stdio, &options->limits, &error)
+        : launch_program(program_name, program_path, exec_fd, spawn_backend, &stdio, &options->limits, &error);
+    pthread_mutex_unlock(&launch_lock);
+    if (output_pipe[1] >= 0) close(output_pipe[1]);
+    if (system_pid < 0) {
+        if (job_id > 0) {
+            emit_notice(announce, "[ERROR] Job %d (%s) cannot execute: %s", job_id, program_name, strerror(error));
         } else {
-            Process* tail = process_list;
-            while (tail->next) {
-                tail = tail->next;
+            emit_notice(announce, "[ERROR] Cannot execute '%s': %s", program_name, strerror(error));
+        }
+        if (output_pipe[0] >= 0) close(output_pipe[0]);
+        destroy_output_ring(output);
+        remove_run_cgroup(options->limits.cgroup);
+        pthread_mutex_lock(&process_lock);
+        starting_count--;
+        pthread_mutex_unlock(&process_lock);
+        return -1;
+    }
+
+    pthread_mutex_lock(&process_lock);
+    int pid = register_process(program_name, system_pid, output_pipe[0], output, options);
+    starting_count--;
+    pthread_mutex_unlock(&process_lock);
+    if (job_id > 0) {
+        emit_notice(announce, "[INFO] Job %d (%s) started as process %d (System PID: %d)",
+                    job_id, program_name, pid, system_pid);
+    } else {
+        emit_notice(announce, "[OK] Process %d started (NeuMiniOS PID: %d, System PID: %d)",
+                    pid, pid, system_pid);
+    }
+    return pid;
+}
+
+// 作业 a 是否应排在 b 前面：优先级高的在前，同优先级先提交的在前
+static int job_before(const Job* a, const Job* b) {
+    if (a->options.priority != b->options.priority) return a->options.priority > b->options.priority;
+    return a->sequence < b->sequence;
+}
+
+static void swap_jobs(int a, int b) {
+    Job temp = job_heap[a];
+    job_heap[a] = job_heap[b];
+    job_heap[b] = temp;
+}
+
+static void sift_up(int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!job_before(&job_heap[index], &job_heap[parent])) break;
+        swap_jobs(index, parent);
+        index = parent;
+    }
+}
+
+static void sift_down(int index) {
+    while (1) {
+        int best = index;
+        int left = index * 2 + 1;
+        int right = left + 1;
+        if (left < job_count && job_before(&job_heap[left], &job_heap[best])) best = left;
+        if (right < job_count && job_before(&job_heap[right], &job_heap[best])) best = right;
+        if (best == index) break;
+        swap_jobs(index, best);
+        index = best;
+    }
+}
+
+// 从堆中取出下标为 index 的作业（堆顶为 0），调用者持有 process_lock
+static Job remove_job(int index) {
+    Job job = job_heap[index];
+    job_count--;
+    if (index < job_count) {
+        job_heap[index] = job_heap[job_count];
+        sift_down(index);
+        sift_up(index);
+    }
+    return job;
+}
+
+// 作业入队，成功返回作业号，队列已满或内存不足返回-1。exec_fd 由队列接管
+static int enqueue_job(const char* program_name, int exec_fd, const RunOptions* options) {
+    pthread_mutex_lock(&process_lock);
+    if (job_count >= MAX_QUEUED_JOBS) {
+        pthread_mutex_unlock(&process_lock);
+        printf("[ERROR] Run queue full (max %d jobs)\n", MAX_QUEUED_JOBS);
+        return -1;
+    }
+    if (job_count == job_heap_capacity) {
+        int new_capacity = job_heap_capacity ? job_heap_capacity * 2 : 16;
+        Job* heap = (Job*)realloc(job_heap, (size_t)new_capacity * sizeof(Job));
+        if (!heap) {
+            pthread_mutex_unlock(&process_lock);
+            printf("Error: Out of memory\n");
+            return -1;
+        }
+        job_heap = heap;
+        job_heap_capacity = new_capacity;
+    }
+    Job* job = &job_heap[job_count];
+    job->id = next_job_id++;
+    if (next_job_id <= 0) next_job_id = 1;
+    snprintf(job->name, sizeof(job->name), "%s", program_name);
+    job->exec_fd = exec_fd;
+    job->options = *options;
+    job->sequence = job_sequence++;
+    clock_gettime(CLOCK_MONOTONIC, &job->submit_time);
+    int id = job->id;
+    job_count++;
+    sift_up(job_count - 1);
+    int queued = job_count;
+    int running = process_count + starting_count;
+    pthread_mutex_unlock(&process_lock);
+
+    printf("[INFO] Job %d (%s) queued with priority %d (%d running, %d queued)\n",
+           id, program_name, options->priority, running, queued);
+    return id;
+}
+
+// 清空运行队列，返回取消的作业数；调用者持有 process_lock
+static int clear_job_queue(void) {
+    int cancelled = job_count;
+    for (int i = 0; i < job_count; i++) {
+        close(job_heap[i].exec_fd);
+    }
+    job_count = 0;
+    return cancelled;
+}
+
+// 在上限以内从堆顶依次启动排队的作业（回收线程释放槽位后、stop 之后调用）
+static void dispatch_jobs(void) {
+    while (1) {
+        pthread_mutex_lock(&process_lock);
+        if (job_count == 0 || process_count + starting_count >= running_limit()) {
+            pthread_mutex_unlock(&process_lock);
+            return;
+        }
+        Job job = remove_job(0);
+        starting_count++;
+        pthread_mutex_unlock(&process_lock);
+
+        start_job(job.name, NULL, job.exec_fd, &job.options, -1, -1, job.id, 0);
+        close(job.exec_fd);
+    }
+}
+
+/*
+ * run：未达到并发上限且没有作业在排队时立即启动，否则排队
+ *
+ * 排队时 exec_fd 复制一份由队列持有；只有路径时打开这个文件（之后路径可以删除）
+ *
+ * @return 已启动返回 NeuMiniOS PID，已排队返回0，失败返回-1
+ */
+static int spawn_program(const char* program_name, const char* program_path, int exec_fd,
+                         const RunOptions* options) {
+    RunOptions defaults;
+    if (!options) {
+        init_run_options(&defaults);
+        options = &defaults;
+    }
+
+    pthread_mutex_lock(&process_lock);
+    int start_now = job_count == 0 && process_count + starting_count < running_limit();
+    if (start_now) starting_count++;
+    pthread_mutex_unlock(&process_lock);
+    if (start_now) {
+        return start_job(program_name, program_path, exec_fd, options, -1, -1, 0, 1);
+    }
+
+    int job_fd = exec_fd >= 0 ? fcntl(exec_fd, F_DUPFD_CLOEXEC, 0) : open(program_path, O_RDONLY | O_CLOEXEC);
+    if (job_fd < 0) {
+        printf("[ERROR] Cannot queue '%s': %s\n", program_name, strerror(errno));
+        return -1;
+    }
+    if (enqueue_job(program_name, job_fd, options) < 0) {
+        close(job_fd);
+        return -1;
+    }
+    // 回收线程可能在入队之前就释放了槽位
+    dispatch_jobs();
+    return 0;
+}
+
+// 创建新进程（run命令），直接执行主机上的程序文件；options 为 NULL 时使用默认选项
+int create_process(const char *program_name, const char *program_path, const RunOptions* options) {
+    return spawn_program(program_name, program_path, -1, options);
+}
+
+// 创建新进程（run命令），执行 create_exec_memfd 得到并已封印的内存文件；返回后 exec_fd 可以关闭
+int create_process_from_fd(const char* program_name, int exec_fd, const RunOptions* options) {
+    return spawn_program(program_name, NULL, exec_fd, options);
+}
+
+/*
+ * 启动一条管道（run a | run b ...）：相邻两级之间用管道连接，各级同时启动并各自登记到进程表
+ *
+ * 管道的各级必须一起启动，不进入运行队列：空闲名额不够时直接报错。
+ * 某一级启动失败时不再启动后面的级，已经启动的级读到 EOF / 写到断开的管道后自行退出。
+ *
+ * @param input_fd   第一级的标准输入（< file 时为管道读端），-1 表示继承终端
+ * @param output_fd  最后一级的标准输出（> file 时为管道写端），-1 表示终端或输出缓冲区
+ *
+ * @return 全部启动返回0，失败返回-1；input_fd / output_fd 仍归调用者
+ */
+int create_pipeline(const PipelineStage* stages, int count, int input_fd, int output_fd) {
+    pthread_mutex_lock(&process_lock);
+    int available = running_limit() - process_count - starting_count;
+    if (count > available) {
+        pthread_mutex_unlock(&process_lock);
+        printf("[ERROR] Pipeline needs %d free slots, %d available (limit %d)\n",
+               count, available > 0 ? available : 0, running_limit());
+        return -1;
+    }
+    starting_count += count;
+    pthread_mutex_unlock(&process_lock);
+
+    // 每调用一次 start_job 用掉一个预留的名额，没用到的在最后归还
+    int stage_input = input_fd;
+    int consumed = 0;
+    int result = 0;
+    while (consumed < count) {
+        int is_last = consumed + 1 == count;
+        int link[2] = {-1, -1};
+        if (!is_last) {
+            if (pipe2(link, O_CLOEXEC) != 0) {
+                printf("[ERROR] Cannot create pipe: %s\n", strerror(errno));
+                result = -1;
+                break;
             }
-            tail->next = node;
+            // 加大管道缓冲区，减少相邻两级之间的切换（超过系统上限时保持默认大小）
+            fcntl(link[1], F_SETPIPE_SZ, PIPELINE_PIPE_SIZE);
         }
-        process_count++;
+        const PipelineStage* stage = &stages[consumed];
+        int pid = start_job(stage->name, NULL, stage->exec_fd, &stage->options, stage_input,
+                            is_last ? output_fd : link[1], 0, 1);
+        consumed++;
+        if (stage_input != input_fd) close(stage_input);
+        if (link[1] >= 0) close(link[1]);
+        stage_input = link[0];
+        if (pid < 0) {
+            result = -1;
+            break;
+        }
+    }
+    if (stage_input >= 0 && stage_input != input_fd) close(stage_input);
+    if (consumed < count) {
+        pthread_mutex_lock(&process_lock);
+        starting_count -= count - consumed;
+        pthread_mutex_unlock(&process_lock);
+    }
+    return result;
+}
+
+/*
+ * 设置同时运行的进程数上限（--max-running），0 表示与进程表容量相同
+ *
+ * 超过进程表容量的值按容量处理
+ */
+void set_max_running(int limit) {
+    pthread_mutex_lock(&process_lock);
+    max_running = limit > 0 ? limit : 0;
+    pthread_mutex_unlock(&process_lock);
+}
+
+int get_max_running(void) {
+    pthread_mutex_lock(&process_lock);
+    int limit = running_limit();
+    pthread_mutex_unlock(&process_lock);
+    return limit;
+}
+
+// 把退出状态写成 "exit 0" / "signal 15 (Terminated)"，brief=1 时省略信号名（表格中使用）
+static void format_exit_status(int status, int brief, char* buffer, size_t size) {
+    if (status < 0) {
+        snprintf(buffer, size, "unknown");
+    } else if (WIFSIGNALED(status)) {
+        if (brief) {
+            snprintf(buffer, size, "signal %d", WTERMSIG(status));
+        } else {
+            snprintf(buffer, size, "signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+        }
+    } else {
+        snprintf(buffer, size, "exit %d", WEXITSTATUS(status));
+    }
+}
 
-        printf("[OK] Process %d started (NeuMiniOS PID: %d, System PID: %d)\n",
-               node->pid, node->pid, system_pid);
+/*
+ * 设置输出捕获（引导时由 --capture / --log-size 设置）
+ *
+ * @param ring_size  每个进程保留的输出字节数
+ */
+void set_output_capture(int enabled, size_t ring_size) {
+    capture_output = enabled;
+    output_ring_size = ring_size;
+}
 
-        return node->pid;
+/*
+ * 设置子进程默认的标准输入（批处理模式从管道读命令时传入 /dev/null，子进程不会读走后面的命令）
+ *
+ * @param fd  引导时打开、一直保持到退出的 fd；-1 表示继承 NeuMiniOS 的标准输入
+ */
+void set_child_input(int fd) {
+    child_input_fd = fd;
+}
+
+/*
+ * 读取进程捕获的输出（plog），运行中和最近退出的进程都可以读取
+ *
+ * @param position  读取位置（累计字节数），从 0 开始，返回时前移
+ * @param dropped   返回 position 之后已被覆盖的字节数
+ * @param running   返回进程是否仍在运行
+ *
+ * @return 读出的字节数；进程不存在返回-1，没有捕获输出返回-2
+ */
+ssize_t read_process_output(int pid, uint64_t* position, char* buffer, size_t size,
+                            uint64_t* dropped, int* running) {
+    pthread_mutex_lock(&process_lock);
+    OutputRing* output = NULL;
+    Process* process = find_process(pid);
+    *running = process != NULL;
+    int found = process != NULL;
+    if (process) {
+        output = process->output;
     } else {
-        perror("[ERROR] fork failed");
+        // 多次退出的记录中取最新的一条
+        for (int i = 0; i < exit_history_count; i++) {
+            const ExitRecord* record = &exit_history[(exit_history_next - 1 - i + EXIT_HISTORY) % EXIT_HISTORY];
+            if (record->pid == pid) {
+                output = record->output;
+                found = 1;
+                break;
+            }
+        }
+    }
+    ssize_t result = !found ? -1 : !output ? -2 : (ssize_t)output_ring_read(output, position, buffer, size, dropped);
+    pthread_mutex_unlock(&process_lock);
+    return result;
+}
+
+// 设置 stop 的宽限期（引导时由 --stop-grace 设置）
+void set_stop_grace(int grace_ms) {
+    stop_grace_ms = grace_ms;
+}
+
+int get_stop_grace(void) {
+    return stop_grace_ms;
+}
+
+static int count_alive(const int* pids, int count) {
+    int alive = 0;
+    for (int i = 0; i < count; i++) {
+        if (find_process(pids[i])) alive++;
+    }
+    return alive;
+}
+
+/*
+ * 等到目标全部被回收或超时，返回仍未回收的数量。调用者持有 process_lock
+ * 回收线程每释放一个槽位广播一次 process_released；没有回收线程时自己轮询 waitpid
+ */
+static int wait_for_targets(const int* pids, int count, int timeout_ms) {
+    struct timespec deadline;
+    deadline_after(timeout_ms, &deadline);
+
+    int alive;
+    while ((alive = count_alive(pids, count)) > 0) {
+        if (reaper_running) {
+            if (pthread_cond_timedwait(&process_released, &process_lock, &deadline) == ETIMEDOUT) {
+                return count_alive(pids, count);
+            }
+            continue;
+        }
+
+        for (int i = 0; i < count; i++) {
+            Process* process = find_process(pids[i]);
+            if (process) try_reap(process);
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (count_alive(pids, count) == 0 || now.tv_sec > deadline.tv_sec ||
+            (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) {
+            break;
+        }
+        struct timespec pause = {0, STOP_POLL_MS * 1000000L};
+        pthread_mutex_unlock(&process_lock);
+        nanosleep(&pause, NULL);
+        pthread_mutex_lock(&process_lock);
+    }
+    return count_alive(pids, count);
+}
+
+// stop 的一个目标：名字在发信号前复制，killed=1 表示宽限期内没有退出、改发了 SIGKILL
+typedef struct {
+    char name[MAX_PROCESS_NAME];
+    int killed;
+} StopTarget;
+
+/*
+ * 同步停止：同时向所有目标发 SIGTERM，一起等待一个宽限期；宽限期后仍在运行的改发 SIGKILL。
+ * 不论目标有多少，最多等待 宽限期 + STOP_KILL_WAIT_MS。调用者持有 process_lock
+ * 只用于系统退出，以及没有回收线程（无人替 stop 计时）的情况
+ *
+ * @param pids   运行中的进程（已去重）
+ * @param quiet  1=不逐个打印结果（系统退出时使用）
+ *
+ * @return 全部停止返回0，有进程无法停止返回-1
+ */
+static int terminate_processes(const int* pids, int count, int quiet) {
+    // 等待期间 process_lock 会被释放，回收线程可能把排队的作业登记到空出的槽位，
+    // 所以名字在发信号之前复制出来，报告结果时不再读槽位
+    StopTarget* targets = (StopTarget*)calloc((size_t)(count > 0 ? count : 1), sizeof(StopTarget));
+    if (!targets) {
+        printf("Error: Out of memory\n");
         return -1;
     }
+    int result = 0;
+    int signalled = 0;
+    for (int i = 0; i < count; i++) {
+        Process* process = find_process(pids[i]);
+        snprintf(targets[i].name, sizeof(targets[i].name), "%s", process->name);
+        // 已退出但还没回收的进程同样可以接收信号
+        if (kill(process->system_pid, SIGTERM) == 0) signalled++;
+    }
+    if (signalled == 0 && count > 0) {
+        perror("Error: Failed to stop process");
+        free(targets);
+        return -1;
+    }
+
+    if (wait_for_targets(pids, count, stop_grace_ms) > 0) {
+        for (int i = 0; i < count; i++) {
+            Process* process = find_process(pids[i]);
+            if (process && kill(process->system_pid, SIGKILL) == 0) {
+                targets[i].killed = 1;
+                if (process->stop_state == STOP_TERM_SENT) process->stop_state = STOP_KILL_SENT;
+            }
+        }
+        wait_for_targets(pids, count, STOP_KILL_WAIT_MS);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const char* name = targets[i].name;
+        if (find_process(pids[i])) {
+            printf("Error: Process %d (%s) did not exit after SIGKILL\n", pids[i], name);
+            result = -1;
+            continue;
+        }
+        // 退出结果由这里报告，不再单独提示；系统退出时，之前 stop 过的进程仍由 report_process_events 报告
+        for (int j = 0; j < exit_history_count; j++) {
+            if (exit_history[j].pid == pids[i] && !(quiet && exit_history[j].stop_state != STOP_NONE)) {
+                exit_history[j].reported = 1;
+            }
+        }
+        if (quiet) continue;
+        if (targets[i].killed) {
+            printf("Process %d (%s) killed after ignoring SIGTERM for %d ms\n",
+                   pids[i], name, stop_grace_ms);
+        } else {
+            printf("Process %d (%s) stopped successfully\n", pids[i], name);
+        }
+    }
+    free(targets);
+    return result;
+}
+
+/*
+ * ruby(stop)：向所有目标发 SIGTERM 后立即返回，不占用 CLI 线程。宽限期由回收线程计时，
+ * 到期仍在运行的改发 SIGKILL；结果在目标被回收后由 report_process_events 在下一个提示符前报告。
+ * 没有回收线程时退回同步停止。调用者持有 process_lock，释放后调用 wake_reaper 让回收线程按新的截止时间等待
+ *
+ * @return 信号全部发出返回0，有进程无法发送信号返回-1
+ */
+static int begin_stop(const int* pids, int count) {
+    if (!reaper_running) return terminate_processes(pids, count, 0);
+
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        Process* process = find_process(pids[i]);
+        if (process->stop_state != STOP_NONE) {
+            printf("Process %d (%s) is already stopping\n", process->pid, process->name);
+            continue;
+        }
+        // 已退出但还没回收的进程同样可以接收信号
+        if (kill(process->system_pid, SIGTERM) != 0) {
+            printf("Error: Failed to stop process %d (%s): %s\n", process->pid, process->name, strerror(errno));
+            result = -1;
+            continue;
+        }
+        process->stop_state = STOP_TERM_SENT;
+        deadline_after(stop_grace_ms, &process->stop_deadline);
+        stopping_count++;
+        printf("Stopping process %d (%s): SIGTERM sent, SIGKILL in %d ms if it keeps running\n",
+               process->pid, process->name, stop_grace_ms);
+    }
+    return result;
+}
+
+/*
+ * 停止一个或多个进程（stop <pid> [pid...]）
+ *
+ * @return 信号全部发出返回0，有 PID 无效或进程无法发送信号返回-1
+ */
+int stop_processes(const int* pids, int count) {
+    int* targets = (int*)malloc((size_t)(count > 0 ? count : 1) * sizeof(int));
+    if (!targets) {
+        printf("Error: Out of memory\n");
+        return -1;
+    }
+
+    int result = 0;
+    int target_count = 0;
+    pthread_mutex_lock(&process_lock);
+    for (int i = 0; i < count; i++) {
+        if (!find_process(pids[i])) {
+            printf("Error: Process %d not found or not running\n", pids[i]);
+            printf("Use 'plist' to see running processes\n");
+            result = -1;
+            continue;
+        }
+        int duplicate = 0;
+        for (int j = 0; j < target_count; j++) {
+            if (targets[j] == pids[i]) duplicate = 1;
+        }
+        if (!duplicate) targets[target_count++] = pids[i];
+    }
+    if (target_count > 0 && begin_stop(targets, target_count) != 0) {
+        result = -1;
+    }
+    pthread_mutex_unlock(&process_lock);
+    wake_reaper();
+    free(targets);
+    // 没有回收线程时，排队的作业在这里接上空出的槽位
+    dispatch_jobs();
+    return result;
 }
 
-// - 链表：已知 prev 时，只需改一次指针（prev->next 或 process_list），不用搬动后续元素
-// - 数组：删除中间元素通常要把后面的元素整体前移，代码更复杂、也更容易出错
 int stop_process(int pid) {
     if (pid <= 0) {
         printf("Error: Invalid process ID: %d\n", pid);
         return -1;
     }
-    
-    Process* prev = NULL;
-    // ruby(stop-链表删除)：通过 find_process 一次遍历同时拿到目标节点和它的前驱节点
-    Process* target = find_process(pid, &prev);
-    if (target && target->status == 1) {
-        if (kill(target->system_pid, 0) != 0) {
-            // 进程已经不存在，只需要从链表中摘掉这个节点
-            // 对于头结点 prev 为 NULL，因此需要单独更新 process_list
-            if (prev) prev->next = target->next; else process_list = target->next;
-            printf("Warning: Process %d (system PID %d) is no longer running\n", 
-                   pid, (int)target->system_pid);
-            free(target);
-            process_count--;
-            return 0;
-        }
-        
-        // 发送终止信号
-        if (kill(target->system_pid, SIGTERM) == 0) {
-            // 等待进程结束
-            int status;
-            waitpid(target->system_pid, &status, 0);
-
-            // 从链表移除并释放：同样只需要一次指针更新 + free
-            // 如果这里是数组实现，则需要把后续元素整体前移，代价更高
-            if (prev) prev->next = target->next; else process_list = target->next;
-            printf("Process %d (%s) stopped successfully\n", pid, target->name);
-            free(target);
-            process_count--;
-            return 0;
-        } else {
-            perror("Error: Failed to stop process");
-            return -1;
+    return stop_processes(&pid, 1);
+}
+
+// 收集所有运行中进程的 PID（按启动顺序），返回数量；调用者持有 process_lock 并负责释放 *pids
+static int collect_running(int** pids) {
+    *pids = (int*)malloc((size_t)(process_count > 0 ? process_count : 1) * sizeof(int));
+    if (!*pids) return -1;
+    int count = 0;
+    for (int slot = first_process; slot >= 0; slot = process_slots[slot].next) {
+        (*pids)[count++] = process_slots[slot].pid;
+    }
+    return count;
+}
+
+// 停止所有运行中的进程（stop --all），先取消排队的作业，避免它们接上空出的槽位
+int stop_all_processes(void) {
+    int* pids = NULL;
+    pthread_mutex_lock(&process_lock);
+    int cancelled = clear_job_queue();
+    if (cancelled > 0) printf("Cancelled %d queued job(s)\n", cancelled);
+    int count = collect_running(&pids);
+    int result = count < 0 ? -1 : 0;
+    if (count == 0) {
+        printf("(no running processes)\n");
+    } else if (count > 0) {
+        result = begin_stop(pids, count);
+    }
+    pthread_mutex_unlock(&process_lock);
+    wake_reaper();
+    free(pids);
+    return result;
+}
+
+// 从 /proc/<pid>/stat 和 /proc/<pid>/status 采样运行中进程的资源使用，失败返回-1
+static int sample_process_usage(pid_t system_pid, ProcessUsage* usage) {
+    char path[64];
+    char buffer[1024];
+    memset(usage, 0, sizeof(*usage));
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)system_pid);
+    FILE* fp = fopen(path, "r");
+    if (!fp) return -1;
+    size_t n = fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    buffer[n] = '\0';
+
+    // 进程名在括号中且可能含空格，从最后一个 ')' 之后开始按字段解析：
+    // 第 3 项是状态，第 14、15 项是 utime / stime（时钟滴答），第 24 项是 rss（页）
+    char* fields = strrchr(buffer, ')');
+    if (!fields) return -1;
+    unsigned long long utime = 0, stime = 0;
+    long rss_pages = 0;
+    if (sscanf(fields + 1, " %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+               &usage->state, &utime, &stime, &rss_pages) != 4) {
+        return -1;
+    }
+    double ticks = (double)sysconf(_SC_CLK_TCK);
+    usage->user_seconds = (double)utime / ticks;
+    usage->system_seconds = (double)stime / ticks;
+    usage->rss_kb = rss_pages * (sysconf(_SC_PAGESIZE) / 1024);
+
+    // 峰值内存和上下文切换次数只在 status 中
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)system_pid);
+    fp = fopen(path, "r");
+    if (fp) {
+        while (fgets(buffer, sizeof(buffer), fp)) {
+            sscanf(buffer, "VmHWM: %ld", &usage->max_rss_kb);
+            sscanf(buffer, "voluntary_ctxt_switches: %ld", &usage->voluntary_switches);
+            sscanf(buffer, "nonvoluntary_ctxt_switches: %ld", &usage->involuntary_switches);
         }
+        fclose(fp);
     }
-    
-    printf("Error: Process %d not found or not running\n", pid);
-    printf("Use 'plist' to see running processes\n");
-    return -1;
+    return 0;
 }
 
-// 列出所有进程（plist命令）
+// 把时长写成 "42.0s" / "12m05s" / "3h07m"
+static void format_duration(double seconds, char* buffer, size_t size) {
+    long whole = (long)seconds;
+    if (seconds < 60.0) {
+        snprintf(buffer, size, "%.1fs", seconds);
+    } else if (whole < 3600) {
+        snprintf(buffer, size, "%ldm%02lds", whole / 60, whole % 60);
+    } else {
+        snprintf(buffer, size, "%ldh%02ldm", whole / 3600, (whole % 3600) / 60);
+    }
+}
+
+static const char* describe_state(char state) {
+    switch (state) {
+        case 'R': return "Running";
+        case 'S': return "Sleeping";
+        case 'D': return "Disk wait";
+        case 'Z': return "Exiting";
+        case 'T': case 't': return "Stopped";
+        default: return "Unknown";
+    }
+}
+
+// 资源限制写成 "as=512M"，字节数按 K/M/G 缩写，不限制为 "inf"
+static int format_limit(char* buffer, size_t size, const char* label, rlim_t value, int bytes) {
+    if (value == RLIM_INFINITY) return snprintf(buffer, size, " %s=inf", label);
+    static const char units[] = "KMG";
+    int unit = -1;
+    while (bytes && unit < 2 && value >= 1024 && value % 1024 == 0) {
+        value /= 1024;
+        unit++;
+    }
+    if (unit >= 0) return snprintf(buffer, size, " %s=%llu%c", label, (unsigned long long)value, units[unit]);
+    return snprintf(buffer, size, " %s=%llu", label, (unsigned long long)value);
+}
+
+// 读出运行中进程实际生效的资源限制（软限制）和所在的 cgroup，写成一行
+static void describe_limits(const Process* process, char* buffer, size_t size) {
+    static const struct {
+        int resource;
+        const char* label;
+        int bytes;
+    } shown[] = {
+        {RLIMIT_AS, "as", 1},
+        {RLIMIT_CPU, "cpu", 0},
+        {RLIMIT_NOFILE, "fd", 0},
+        {RLIMIT_CORE, "core", 1},
+    };
+    size_t used = 0;
+    buffer[0] = '\0';
+    for (size_t i = 0; i < sizeof(shown) / sizeof(shown[0]) && used < size; i++) {
+        struct rlimit limit;
+        int n = prlimit(process->system_pid, shown[i].resource, NULL, &limit) == 0
+            ? format_limit(buffer + used, size - used, shown[i].label, limit.rlim_cur, shown[i].bytes)
+            : snprintf(buffer + used, size - used, " %s=?", shown[i].label);
+        if (n > 0) used += (size_t)n;
+    }
+    const char* cgroup = strrchr(process->options.limits.cgroup, '/');
+    if (cgroup && used < size) {
+        snprintf(buffer + used, size - used, " cg=%s", cgroup + 1);
+    }
+}
+
+#define PLIST_HEADER_FORMAT "%-8s %-10s %-16s %-10s %9s %9s %10s %10s %8s"
+#define PLIST_ROW_FORMAT "%-8d %-10d %-16.16s %-10s %9.2f %9ld %10ld %10s %8s"
+#define PLIST_RULE "-----------------------------------------------------------------------------------------------------------------------------------\n"
+
+// 列出所有进程（plist命令），按启动顺序；之后列出最近退出的进程、退出状态和资源使用
+// CPU 为用户态 + 内核态时间，CtxSw 为 主动/被动 上下文切换次数，Limits 为实际生效的资源限制
 void list_processes(void) {
+    // 与 ptop 一样，持锁时只复制表项和退出记录，读 /proc、prlimit 和输出都在锁外进行，不阻塞回收线程
+    pthread_mutex_lock(&process_lock);
+    Process* running = (Process*)malloc((size_t)(process_count > 0 ? process_count : 1) * sizeof(Process));
+    ExitRecord* exited = (ExitRecord*)malloc((size_t)(exit_history_count > 0 ? exit_history_count : 1) *
+                                             sizeof(ExitRecord));
     int running_count = 0;
-    
-    printf("=== Running Processes (max %d) ===\n", MAX_PROCESSES);
-    printf("%-10s %-10s %-20s %s\n", "PID", "System PID", "Name", "Status");
-    printf("------------------------------------------------\n");
-    
-    for (Process* curr = process_list; curr; curr = curr->next) {
-        if (curr->status == 1) {
-            printf("%-10d %-10d %-20s %s\n",
-                   curr->pid,
-                   (int)curr->system_pid,
-                   curr->name,
-                   "Running");
-            running_count++;
+    int exited_count = 0;
+    for (int slot = first_process; running && slot >= 0; slot = process_slots[slot].next) {
+        if (process_slots[slot].status == 1) running[running_count++] = process_slots[slot];
+    }
+    // 从最早的一条开始
+    int first = (exit_history_next - exit_history_count + EXIT_HISTORY) % EXIT_HISTORY;
+    for (int i = 0; exited && i < exit_history_count; i++) {
+        exited[exited_count++] = exit_history[(first + i) % EXIT_HISTORY];
+    }
+    int capacity = process_capacity;
+    pthread_mutex_unlock(&process_lock);
+    if (!running || !exited) {
+        free(running);
+        free(exited);
+        printf("Error: Out of memory\n");
+        return;
+    }
+
+    printf("=== Running Processes (max %d) ===\n", capacity);
+    printf(PLIST_HEADER_FORMAT " %s\n", "PID", "System PID", "Name", "Status", "CPU(s)", "RSS(KB)", "MaxRSS(KB)", "CtxSw",
+           "Uptime", "Limits");
+    printf(PLIST_RULE);
+    for (int i = 0; i < running_count; i++) {
+        const Process* curr = &running[i];
+        ProcessUsage usage;
+        if (sample_process_usage(curr->system_pid, &usage) != 0) {
+            usage.state = '?';
         }
+        char uptime[32];
+        char switches[32];
+        char limits[96];
+        format_duration(seconds_since(&curr->start_time), uptime, sizeof(uptime));
+        snprintf(switches, sizeof(switches), "%ld/%ld", usage.voluntary_switches, usage.involuntary_switches);
+        describe_limits(curr, limits, sizeof(limits));
+        printf(PLIST_ROW_FORMAT "%s\n",
+               curr->pid,
+               (int)curr->system_pid,
+               curr->name,
+               describe_state(usage.state),
+               usage.user_seconds + usage.system_seconds,
+               usage.rss_kb,
+               usage.max_rss_kb,
+               switches,
+               uptime,
+               limits);
     }
     // 使用 status == 1 过滤出“运行中”的进程，便于以后扩展其他状态。
     
@@ -237,21 +1626,382 @@ void list_processes(void) {
     } else {
         printf("Total: %d process(es) running\n", running_count);
     }
+
+    if (exited_count > 0) {
+        printf("\n=== Recently Exited ===\n");
+        printf(PLIST_HEADER_FORMAT "\n", "PID", "System PID", "Name", "Result", "CPU(s)", "", "MaxRSS(KB)", "CtxSw", "Ran for");
+        printf(PLIST_RULE);
+        for (int i = 0; i < exited_count; i++) {
+            const ExitRecord* record = &exited[i];
+            const ProcessUsage* usage = &record->usage;
+            char result[64];
+            char switches[32];
+            char ran_for[32];
+            format_exit_status(record->status, 1, result, sizeof(result));
+            snprintf(switches, sizeof(switches), "%ld/%ld", usage->voluntary_switches, usage->involuntary_switches);
+            format_duration(usage->uptime_seconds, ran_for, sizeof(ran_for));
+            printf("%-8d %-10d %-16.16s %-10s %9.2f %9s %10ld %10s %8s\n",
+                   record->pid, (int)record->system_pid, record->name, result,
+                   usage->user_seconds + usage->system_seconds, "", usage->max_rss_kb, switches, ran_for);
+        }
+    }
+    free(running);
+    free(exited);
+}
+
+#define JOBS_HEADER_FORMAT "%-8s %-16s %8s %6s %-12s %8s\n"
+#define JOBS_ROW_FORMAT "%-8d %-16.16s %8d %6s %-12.12s %8s\n"
+#define JOBS_RULE "-------------------------------------------------------------\n"
+
+static int compare_jobs(const void* a, const void* b) {
+    const Job* left = (const Job*)a;
+    const Job* right = (const Job*)b;
+    if (job_before(left, right)) return -1;
+    return job_before(right, left) ? 1 : 0;
+}
+
+// 列出排队的作业（按启动顺序）和运行中的进程（jobs命令）
+void list_jobs(void) {
+    pthread_mutex_lock(&process_lock);
+    printf("=== Queued Jobs (%d running, limit %d) ===\n", process_count, running_limit());
+    printf(JOBS_HEADER_FORMAT, "Job", "Name", "Priority", "Nice", "CPUs", "Waiting");
+    printf(JOBS_RULE);
+    // 堆只保证堆顶最先启动，复制一份排好序再列出
+    Job* sorted = job_count > 0 ? (Job*)malloc((size_t)job_count * sizeof(Job)) : NULL;
+    if (sorted) {
+        memcpy(sorted, job_heap, (size_t)job_count * sizeof(Job));
+        qsort(sorted, (size_t)job_count, sizeof(Job), compare_jobs);
+    }
+    for (int i = 0; i < job_count; i++) {
+        const Job* job = sorted ? &sorted[i] : &job_heap[i];
+        char nice_value[16];
+        char waiting[32];
+        if (job->options.limits.has_nice) {
+            snprintf(nice_value, sizeof(nice_value), "%d", job->options.limits.nice);
+        } else {
+            snprintf(nice_value, sizeof(nice_value), "-");
+        }
+        format_duration(seconds_since(&job->submit_time), waiting, sizeof(waiting));
+        printf(JOBS_ROW_FORMAT, job->id, job->name, job->options.priority, nice_value,
+               job->options.limits.cpus[0] ? job->options.limits.cpus : "all", waiting);
+    }
+    free(sorted);
+    if (job_count == 0) printf("(no queued jobs)\n");
+
+    printf("\n=== Running ===\n");
+    printf(JOBS_HEADER_FORMAT, "PID", "Name", "Priority", "Nice", "CPUs", "Uptime");
+    printf(JOBS_RULE);
+    for (int slot = first_process; slot >= 0; slot = process_slots[slot].next) {
+        const Process* curr = &process_slots[slot];
+        // 显示实际的 nice 值（子进程可能自己改过）
+        char nice_value[16];
+        errno = 0;
+        int nice = getpriority(PRIO_PROCESS, (id_t)curr->system_pid);
+        if (nice == -1 && errno != 0) {
+            snprintf(nice_value, sizeof(nice_value), "?");
+        } else {
+            snprintf(nice_value, sizeof(nice_value), "%d", nice);
+        }
+        char uptime[32];
+        format_duration(seconds_since(&curr->start_time), uptime, sizeof(uptime));
+        printf(JOBS_ROW_FORMAT, curr->pid, curr->name, curr->options.priority, nice_value,
+               curr->options.limits.cpus[0] ? curr->options.limits.cpus : "all", uptime);
+    }
+    if (process_count == 0) printf("(no running processes)\n");
+    pthread_mutex_unlock(&process_lock);
+}
+
+/*
+ * 取消一个排队的作业（jobs --cancel <id>）
+ *
+ * @return 成功返回0，作业不存在（已经启动或无效）返回-1
+ */
+int cancel_job(int job_id) {
+    pthread_mutex_lock(&process_lock);
+    for (int i = 0; i < job_count; i++) {
+        if (job_heap[i].id != job_id) continue;
+        Job job = remove_job(i);
+        pthread_mutex_unlock(&process_lock);
+        close(job.exec_fd);
+        printf("Job %d (%s) cancelled\n", job.id, job.name);
+        return 0;
+    }
+    pthread_mutex_unlock(&process_lock);
+    printf("Error: Job %d not found in the run queue\n", job_id);
+    printf("Use 'jobs' to see queued jobs\n");
+    return -1;
+}
+
+// ptop 的一行：上一帧的 CPU 时间用来算这一帧的 CPU 占用率
+typedef struct {
+    int pid;
+    pid_t system_pid;
+    char name[MAX_PROCESS_NAME];
+    struct timespec start_time;
+    ProcessUsage usage;
+    double cpu_percent;
+} TopEntry;
+
+static TopEntry* top_previous = NULL;
+static int top_previous_count = 0;
+static struct timespec top_previous_time;
+static int top_sort_by_memory = 0;
+
+static int compare_top_entries(const void* a, const void* b) {
+    const TopEntry* x = (const TopEntry*)a;
+    const TopEntry* y = (const TopEntry*)b;
+    if (top_sort_by_memory) {
+        return (y->usage.rss_kb > x->usage.rss_kb) - (y->usage.rss_kb < x->usage.rss_kb);
+    }
+    return (y->cpu_percent > x->cpu_percent) - (y->cpu_percent < x->cpu_percent);
 }
 
-// ruby(exit)：系统退出时清理所有子进程并释放链表节点
+/*
+ * 打印一帧 ptop：按 CPU 占用率（或常驻内存）从高到低列出运行中的进程
+ * CPU 占用率 = 两帧之间 CPU 时间的增量 / 经过的时间；第一帧用整个运行期间的平均值
+ *
+ * @param sort_by_memory  1=按常驻内存排序
+ *
+ * @return 运行中的进程数，内存不足返回-1
+ */
+int print_process_top(int sort_by_memory) {
+    // 持锁时只复制表项，读 /proc 在锁外进行，不阻塞回收线程
+    pthread_mutex_lock(&process_lock);
+    TopEntry* entries = (TopEntry*)calloc((size_t)(process_count > 0 ? process_count : 1), sizeof(TopEntry));
+    int count = 0;
+    for (int slot = first_process; entries && slot >= 0; slot = process_slots[slot].next) {
+        Process* curr = &process_slots[slot];
+        entries[count].pid = curr->pid;
+        entries[count].system_pid = curr->system_pid;
+        snprintf(entries[count].name, sizeof(entries[count].name), "%s", curr->name);
+        entries[count].start_time = curr->start_time;
+        count++;
+    }
+    int capacity = process_capacity;
+    pthread_mutex_unlock(&process_lock);
+    if (!entries) return -1;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double interval = top_previous ? seconds_since(&top_previous_time) : 0.0;
+    double total_cpu = 0.0;
+    long total_rss = 0;
+    int sampled = 0;
+    for (int i = 0; i < count; i++) {
+        TopEntry* entry = &entries[i];
+        if (sample_process_usage(entry->system_pid, &entry->usage) != 0) {
+            entry->usage.state = '?';
+            continue;
+        }
+        entry->usage.uptime_seconds = seconds_since(&entry->start_time);
+        double cpu = entry->usage.user_seconds + entry->usage.system_seconds;
+        double elapsed = entry->usage.uptime_seconds;
+        // 上一帧之后启动的进程没有上一帧的数据，同样用平均值
+        for (int j = 0; j < top_previous_count && interval > 0.0; j++) {
+            if (top_previous[j].pid == entry->pid) {
+                cpu -= top_previous[j].usage.user_seconds + top_previous[j].usage.system_seconds;
+                elapsed = interval;
+                break;
+            }
+        }
+        entry->cpu_percent = elapsed > 0.0 ? cpu * 100.0 / elapsed : 0.0;
+        total_cpu += entry->cpu_percent;
+        total_rss += entry->usage.rss_kb;
+        sampled++;
+    }
+
+    // 保存这一帧（排序前后的内容相同，按 PID 查找）
+    free(top_previous);
+    top_previous = entries;
+    top_previous_count = count;
+    top_previous_time = now;
+
+    TopEntry* sorted = (TopEntry*)malloc((size_t)(count > 0 ? count : 1) * sizeof(TopEntry));
+    if (!sorted) return -1;
+    memcpy(sorted, entries, (size_t)count * sizeof(TopEntry));
+    top_sort_by_memory = sort_by_memory;
+    qsort(sorted, (size_t)count, sizeof(TopEntry), compare_top_entries);
+
+    printf("Processes: %d running (max %d), CPU %.1f%%, RSS %ld KB\n\n", sampled, capacity, total_cpu, total_rss);
+    printf("%-8s %-10s %-16s %-10s %6s %9s %9s %10s %10s %8s\n",
+           "PID", "System PID", "Name", "Status", "%CPU", "CPU(s)", "RSS(KB)", "MaxRSS(KB)", "CtxSw", "Uptime");
+    for (int i = 0; i < count; i++) {
+        const TopEntry* entry = &sorted[i];
+        char switches[32];
+        char uptime[32];
+        snprintf(switches, sizeof(switches), "%ld/%ld",
+                 entry->usage.voluntary_switches, entry->usage.involuntary_switches);
+        format_duration(entry->usage.uptime_seconds, uptime, sizeof(uptime));
+        printf("%-8d %-10d %-16.16s %-10s %6.1f %9.2f %9ld %10ld %10s %8s\n",
+               entry->pid, (int)entry->system_pid, entry->name, describe_state(entry->usage.state),
+               entry->cpu_percent, entry->usage.user_seconds + entry->usage.system_seconds,
+               entry->usage.rss_kb, entry->usage.max_rss_kb, switches, uptime);
+    }
+    if (count == 0) printf("(no running processes)\n");
+    free(sorted);
+    return count;
+}
+
+// ptop 退出时丢弃上一帧，下次打开时重新从平均值开始
+void reset_process_top(void) {
+    free(top_previous);
+    top_previous = NULL;
+    top_previous_count = 0;
+}
+
+// 提示回收线程在上一条命令之后回收的进程和启动的作业（CLI 在显示提示符前调用）
+void report_process_events(void) {
+    pthread_mutex_lock(&process_lock);
+    int first = (exit_history_next - exit_history_count + EXIT_HISTORY) % EXIT_HISTORY;
+    for (int i = 0; i < exit_history_count; i++) {
+        ExitRecord* record = &exit_history[(first + i) % EXIT_HISTORY];
+        if (record->reported) continue;
+        // 被 stop 的进程报告 stop 的结果
+        if (record->stop_state == STOP_KILL_SENT) {
+            printf("Process %d (%s) killed after ignoring SIGTERM for %d ms\n", record->pid, record->name,
+                   stop_grace_ms);
+        } else if (record->stop_state == STOP_TERM_SENT) {
+            printf("Process %d (%s) stopped successfully\n", record->pid, record->name);
+        } else {
+            char result[64];
+            format_exit_status(record->status, 0, result, sizeof(result));
+            printf("[INFO] Process %d (%s) exited: %s\n", record->pid, record->name, result);
+        }
+        record->reported = 1;
+    }
+    // 退出在前：作业通常是在前面的进程退出后才启动的
+    int first_notice = (notice_next - notice_count + NOTICE_HISTORY) % NOTICE_HISTORY;
+    for (int i = 0; i < notice_count; i++) {
+        printf("%s\n", notices[(first_notice + i) % NOTICE_HISTORY]);
+    }
+    notice_count = 0;
+    pthread_mutex_unlock(&process_lock);
+}
+
+// 基准测试中的启动方式：两个本地后端，外加 zygote（启用时）
+typedef enum {
+    BENCH_FORK = 0,
+    BENCH_POSIX_SPAWN,
+    BENCH_ZYGOTE
+} BenchMode;
+
+// 测一次启动耗时（微秒）：从发起启动到 exec 完成，子进程不进入进程表，随后直接回收
+// （经 zygote 启动的子进程同样挂在本进程下）。子进程的输出写到 null_fd（/dev/null）
+static double time_one_launch(const char* program_name, int exec_fd, int null_fd, BenchMode mode) {
+    struct timespec start, end;
+    int error = 0;
+    pid_t system_pid;
+    ChildStdio stdio = {-1, null_fd, null_fd};
+    // 回收线程可能正在启动排队的作业，zygote 连接同一时刻只能有一个请求
+    pthread_mutex_lock(&launch_lock);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (mode == BENCH_ZYGOTE) {
+        system_pid = zygote_launch(program_name, NULL, exec_fd, &stdio, NULL, &error);
+    } else {
+        system_pid = launch_program(program_name, NULL, exec_fd,
+                                    mode == BENCH_FORK ? SPAWN_BACKEND_FORK : SPAWN_BACKEND_POSIX_SPAWN, &stdio,
+                                    NULL, &error);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_mutex_unlock(&launch_lock);
+    if (system_pid < 0) return -1.0;
+    waitpid(system_pid, NULL, 0);
+    return (double)(end.tv_sec - start.tv_sec) * 1e6 + (double)(end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+// 取 runs 次启动的平均耗时，失败返回 -1
+static double average_launch(const char* program_name, int exec_fd, int null_fd, BenchMode mode, int runs) {
+    double total = 0.0;
+    for (int i = 0; i < runs; i++) {
+        double elapsed = time_one_launch(program_name, exec_fd, null_fd, mode);
+        if (elapsed < 0) return -1.0;
+        total += elapsed;
+    }
+    return total / runs;
+}
+
+/*
+ * 启动耗时基准：在父进程堆上逐步增加已写入的内存（模拟越来越大的磁盘镜像），
+ * 分别测 fork、posix_spawn 和 zygote（--zygote 启动时）启动 exec_fd 的平均耗时
+ *
+ * @param max_mb  额外堆内存的上限，从 0 开始每次翻倍
+ *
+ * @return 成功返回0，程序无法启动返回-1
+ */
+int benchmark_spawn(const char* program_name, int exec_fd, int runs, size_t max_mb) {
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null_fd < 0) {
+        perror("Error: Cannot open /dev/null");
+        return -1;
+    }
+    int with_zygote = zygote_running();
+    printf("=== Launch latency (average of %d runs, microseconds) ===\n", runs);
+    printf("%-12s %-14s %-14s %s\n", "Extra heap", "fork", "posix_spawn", with_zygote ? "zygote" : "");
+    printf("--------------------------------------------------------\n");
+
+    unsigned char* ballast = NULL;
+    size_t mb = 0;
+    while (1) {
+        // 写满每一页，让这些内存真正出现在页表中
+        if (mb > 0) {
+            unsigned char* grown = (unsigned char*)realloc(ballast, mb << 20);
+            if (!grown) {
+                printf("(stopped: cannot allocate %zu MB)\n", mb);
+                break;
+            }
+            ballast = grown;
+            memset(ballast, 0xA5, mb << 20);
+        }
+
+        double fork_us = average_launch(program_name, exec_fd, null_fd, BENCH_FORK, runs);
+        double spawn_us = average_launch(program_name, exec_fd, null_fd, BENCH_POSIX_SPAWN, runs);
+        double zygote_us = with_zygote ? average_launch(program_name, exec_fd, null_fd, BENCH_ZYGOTE, runs) : 0.0;
+        if (fork_us < 0 || spawn_us < 0 || zygote_us < 0) {
+            free(ballast);
+            close(null_fd);
+            printf("[ERROR] Cannot execute '%s'\n", program_name);
+            return -1;
+        }
+        if (with_zygote) {
+            printf("%-9zu MB %-14.1f %-14.1f %.1f\n", mb, fork_us, spawn_us, zygote_us);
+        } else {
+            printf("%-9zu MB %-14.1f %.1f\n", mb, fork_us, spawn_us);
+        }
+
+        if (mb >= max_mb) break;
+        mb = mb ? mb * 2 : 16;
+        if (mb > max_mb) mb = max_mb;
+    }
+    free(ballast);
+    close(null_fd);
+    return 0;
+}
+
+// ruby(exit)：系统退出时清理所有子进程并释放进程表
 void cleanup_process_table(void) {
-    Process* curr = process_list;
-    while (curr) {
+    // 先让所有子进程一起正常退出（一个宽限期），剩下的在下面强制结束
+    int* pids = NULL;
+    pthread_mutex_lock(&process_lock);
+    clear_job_queue();
+    int count = collect_running(&pids);
+    if (count > 0) terminate_processes(pids, count, 1);
+    pthread_mutex_unlock(&process_lock);
+    free(pids);
+    // 还没报告的 stop 结果和提示
+    report_process_events();
+
+    stop_reaper();
+    for (int slot = first_process; slot >= 0; slot = process_slots[slot].next) {
+        Process* curr = &process_slots[slot];
         if (curr->status == 1) {
             kill(curr->system_pid, SIGKILL);
             waitpid(curr->system_pid, NULL, 0);
         }
-        Process* next = curr->next;
-        free(curr);
-        curr = next;
     }
-    process_list = NULL;
-    process_count = 0;
+    free_process_table();
+    free(job_heap);
+    job_heap = NULL;
+    job_heap_capacity = 0;
+    notice_count = 0;
     printf("[INFO] All processes cleaned up\n");
-}
\ No newline at end of file
+}
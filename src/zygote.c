@@ -0,0 +1,297 @@
+#define _GNU_SOURCE   // MSG_NOSIGNAL / MSG_CMSG_CLOEXEC / CLONE_PARENT / pipe2
+#include "../include/zygote.h"
+#include "../include/process.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+// ruby(zygote)：与进程表一样用模块内的全局状态，只在 CLI 线程中访问
+static pid_t zygote_pid = -1;
+static int zygote_sock = -1;
+
+// zygote 中的 SIGCHLD 处理：回收 launch_program 退回路径启动的子进程，避免僵尸进程
+static void reap_children(int sig) {
+    (void)sig;
+    int saved_errno = errno;
+    while (waitpid(-1, NULL, WNOHANG) > 0) {
+    }
+    errno = saved_errno;
+}
+
+// 收一个启动请求，附带的 fd（最多 ZYGOTE_MAX_FDS 个）按发送顺序存入 fds，数量通过 fd_count 返回
+// 返回请求内容的长度，连接关闭或出错返回-1
+static ssize_t receive_request(int sock, char* buffer, size_t size, int fds[ZYGOTE_MAX_FDS], int* fd_count) {
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(ZYGOTE_MAX_FDS * sizeof(int))];
+    } control;
+    struct iovec iov = {buffer, size};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    *fd_count = 0;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (n > 0 && cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        *fd_count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        memcpy(fds, CMSG_DATA(cmsg), (size_t)*fd_count * sizeof(int));
+    }
+    return n > 0 ? n : -1;
+}
+
+/*
+ * 以 CLONE_PARENT 创建子进程并执行程序：子进程的父进程是 NeuMiniOS 主进程而不是 zygote，
+ * 主进程可以像直接启动的子进程一样等待它、取得退出码。exec 是否成功仍用 O_CLOEXEC 管道确认
+ *
+ * @param error  exec 失败时返回 errno（这时仍返回子进程的 PID，由主进程回收）
+ *
+ * @return 子进程的系统 PID，clone 失败返回-1
+ */
+static pid_t spawn_reparented(const char* program_name, const char* program_path, int exec_fd, const ChildStdio* stdio,
+                              const ProcessLimits* limits, int* error) {
+    int status_pipe[2];
+    if (pipe2(status_pipe, O_CLOEXEC) != 0) {
+        *error = errno;
+        return -1;
+    }
+
+    // 不传新栈时 clone 与 fork 一样复制地址空间（zygote 单线程，不需要 atfork 处理）
+    pid_t pid = (pid_t)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+    if (pid == 0) {
+        char* const argv[] = {(char*)program_name, NULL};
+        close(status_pipe[0]);
+        redirect_child_stdio(stdio);
+        if (apply_process_limits(limits) == 0) {
+            if (exec_fd >= 0) {
+                fexecve(exec_fd, argv, environ);
+            } else {
+                execv(program_path, argv);
+            }
+        }
+        int child_error = errno;
+        ssize_t ignored = write(status_pipe[1], &child_error, sizeof(child_error));
+        (void)ignored;
+        _exit(127);
+    }
+    close(status_pipe[1]);
+    if (pid < 0) {
+        *error = errno;
+        close(status_pipe[0]);
+        return -1;
+    }
+
+    int child_error = 0;
+    ssize_t n;
+    do {
+        n = read(status_pipe[0], &child_error, sizeof(child_error));
+    } while (n < 0 && errno == EINTR);
+    close(status_pipe[0]);
+    *error = n == (ssize_t)sizeof(child_error) ? child_error : 0;
+    return pid;
+}
+
+// zygote 主循环：逐个处理启动请求，主进程关闭连接后退出
+static void zygote_main(int sock) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = reap_children;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, NULL);
+
+    char buffer[ZYGOTE_MAX_MESSAGE + 1];
+    while (1) {
+        int fds[ZYGOTE_MAX_FDS];
+        int fd_count = 0;
+        ssize_t n = receive_request(sock, buffer, ZYGOTE_MAX_MESSAGE, fds, &fd_count);
+        if (n < 0) break;
+
+        ZygoteReply reply = {-1, EINVAL};
+        ZygoteRequest request;
+        if ((size_t)n >= sizeof(request)) {
+            memcpy(&request, buffer, sizeof(request));
+            buffer[n] = '\0';
+            // 请求内容：程序路径 '\0' 程序名 '\0'；fd 依次为可执行文件、输入、输出、错误（只含标志位指明的）
+            const char* program_path = buffer + sizeof(request);
+            const char* program_name = program_path + strlen(program_path) + 1;
+            int has_exec_fd = (request.flags & ZYGOTE_FLAG_FD) != 0;
+            int next_fd = has_exec_fd;
+            int exec_fd = has_exec_fd ? fds[0] : -1;
+            ChildStdio stdio;
+            stdio.input = (request.flags & ZYGOTE_FLAG_INPUT) && next_fd < fd_count ? fds[next_fd++] : -1;
+            stdio.output = (request.flags & ZYGOTE_FLAG_OUTPUT) && next_fd < fd_count ? fds[next_fd++] : -1;
+            stdio.error = (request.flags & ZYGOTE_FLAG_ERROR) && next_fd < fd_count ? fds[next_fd++] : -1;
+            if (request.length == (size_t)n - sizeof(request) && program_name < buffer + n &&
+                fd_count == next_fd && (has_exec_fd || program_path[0] != '\0')) {
+                int error = 0;
+                const char* path = program_path[0] ? program_path : NULL;
+                // cgroup 路径来自请求，保证以 '\0' 结尾
+                request.limits.cgroup[sizeof(request.limits.cgroup) - 1] = '\0';
+                reply.pid = spawn_reparented(program_name, path, exec_fd, &stdio, &request.limits, &error);
+                if (reply.pid < 0 && error == EINVAL) {
+                    // 内核不允许 CLONE_PARENT 时退回普通启动，子进程由 zygote 回收
+                    error = 0;
+                    reply.pid = launch_program(program_name, path, exec_fd, get_spawn_backend(), &stdio,
+                                               &request.limits, &error);
+                }
+                reply.error = error;
+            }
+        }
+        for (int i = 0; i < fd_count; i++) {
+            close(fds[i]);
+        }
+
+        if (send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) != (ssize_t)sizeof(reply)) break;
+    }
+    _exit(0);
+}
+
+/*
+ * 分出 zygote 进程（应在启动回收线程和加载磁盘镜像之前调用，此时进程只有一个线程、地址空间最小）
+ *
+ * @return 成功返回0，失败返回-1（之后的 run 直接由主进程启动）
+ */
+int start_zygote(void) {
+    if (zygote_pid > 0) return 0;
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0) {
+        return -1;
+    }
+
+    // 分出子进程前刷掉 stdio 缓冲区，避免同一段输出被打印两次
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sockets[0]);
+        close(sockets[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(sockets[0]);
+        zygote_main(sockets[1]);
+    }
+
+    close(sockets[1]);
+    zygote_pid = pid;
+    zygote_sock = sockets[0];
+    return 0;
+}
+
+// 关闭连接并等待 zygote 退出（它启动的子进程由进程表先行清理）
+void stop_zygote(void) {
+    if (zygote_pid <= 0) return;
+    close(zygote_sock);
+    waitpid(zygote_pid, NULL, 0);
+    zygote_sock = -1;
+    zygote_pid = -1;
+}
+
+int zygote_running(void) {
+    return zygote_pid > 0;
+}
+
+/*
+ * 请 zygote 启动一个程序（exec_fd >= 0 时执行该 fd，否则执行 program_path）
+ *
+ * zygote 意外退出时停用它，之后的启动回到主进程。
+ *
+ * @param stdio  子进程的标准输入 / 输出 / 错误，NULL 表示全部继承终端
+ * @param limits  子进程 exec 之前设置的资源限制、nice 和 CPU 亲和性，NULL 表示不设置
+ * @param error  失败时返回 errno
+ *
+ * @return 子进程的系统 PID（本进程的子进程），失败返回-1
+ */
+pid_t zygote_launch(const char* program_name, const char* program_path, int exec_fd, const ChildStdio* stdio,
+                    const ProcessLimits* limits, int* error) {
+    ChildStdio inherit = {-1, -1, -1};
+    if (!stdio) stdio = &inherit;
+    char buffer[ZYGOTE_MAX_MESSAGE];
+    const char* path = exec_fd >= 0 || !program_path ? "" : program_path;
+    size_t path_length = strlen(path) + 1;
+    size_t name_length = strlen(program_name) + 1;
+    if (sizeof(ZygoteRequest) + path_length + name_length > sizeof(buffer)) {
+        *error = E2BIG;
+        return -1;
+    }
+
+    ZygoteRequest request;
+    memset(&request, 0, sizeof(request));
+    request.flags = (exec_fd >= 0 ? ZYGOTE_FLAG_FD : 0) | (stdio->input >= 0 ? ZYGOTE_FLAG_INPUT : 0) |
+                    (stdio->output >= 0 ? ZYGOTE_FLAG_OUTPUT : 0) | (stdio->error >= 0 ? ZYGOTE_FLAG_ERROR : 0);
+    request.length = (uint32_t)(path_length + name_length);
+    if (limits) {
+        request.limits = *limits;
+    } else {
+        init_process_limits(&request.limits);
+    }
+    memcpy(buffer, &request, sizeof(request));
+    memcpy(buffer + sizeof(request), path, path_length);
+    memcpy(buffer + sizeof(request) + path_length, program_name, name_length);
+
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(ZYGOTE_MAX_FDS * sizeof(int))];
+    } control;
+    struct iovec iov = {buffer, sizeof(request) + request.length};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    int fds[ZYGOTE_MAX_FDS];
+    int fd_count = 0;
+    if (exec_fd >= 0) fds[fd_count++] = exec_fd;
+    if (stdio->input >= 0) fds[fd_count++] = stdio->input;
+    if (stdio->output >= 0) fds[fd_count++] = stdio->output;
+    if (stdio->error >= 0) fds[fd_count++] = stdio->error;
+    if (fd_count > 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.space;
+        msg.msg_controllen = CMSG_SPACE((size_t)fd_count * sizeof(int));
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN((size_t)fd_count * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, (size_t)fd_count * sizeof(int));
+    }
+
+    ZygoteReply reply;
+    ssize_t n;
+    if (sendmsg(zygote_sock, &msg, MSG_NOSIGNAL) < 0) {
+        n = -1;
+    } else {
+        do {
+            n = recv(zygote_sock, &reply, sizeof(reply), 0);
+        } while (n < 0 && errno == EINTR);
+    }
+    if (n != (ssize_t)sizeof(reply)) {
+        printf("Warning: Zygote process exited, launching directly from now on\n");
+        stop_zygote();
+        return launch_program(program_name, program_path, exec_fd, get_spawn_backend(), stdio, limits, error);
+    }
+
+    if (reply.error != 0) {
+        // exec 失败的子进程已经挂到本进程下，在这里回收
+        if (reply.pid > 0) waitpid(reply.pid, NULL, 0);
+        *error = reply.error;
+        return -1;
+    }
+    return reply.pid;
+}